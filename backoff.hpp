@@ -0,0 +1,208 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include "timer.hpp"
+
+/**
+ * @brief 回退等待的统计: 回退时长、唤醒延迟和到达间隔
+ *
+ * 嵌入生产者、读取器和消费者各自的统计类中使用。
+ */
+class BackoffStats {
+public:
+    void record_pause(uint64_t ticks) {
+        pause_count++;
+        pause_ticks += ticks;
+        update_max(max_pause_ticks, ticks);
+    }
+
+    /**
+     * @brief 记录一次从回退中恢复
+     * @param ticks 恢复前最后一次回退的时长，即回退给这条消息带来的额外延迟的上界
+     */
+    void record_wake(uint64_t ticks) {
+        wake_count++;
+        wake_ticks += ticks;
+        update_max(max_wake_ticks, ticks);
+    }
+
+    void record_interval(uint64_t ticks) {
+        interval_ticks = ticks;
+    }
+
+    std::string get_stats() const {
+        std::stringstream ss;
+        const auto pauses = pause_count.load();
+        const auto wakes = wake_count.load();
+        if (pauses > 0) {
+            ss << "平均回退时长: " << HighResolutionTimer::to_ns(pause_ticks.load() / pauses) << " ns"
+               << " (最大 " << HighResolutionTimer::to_ns(max_pause_ticks.load()) << " ns)\n";
+        }
+        if (wakes > 0) {
+            ss << "唤醒次数: " << wakes
+               << ", 平均唤醒延迟上界: " << HighResolutionTimer::to_ns(wake_ticks.load() / wakes) << " ns"
+               << " (最大 " << HighResolutionTimer::to_ns(max_wake_ticks.load()) << " ns)\n";
+        }
+        const auto interval = interval_ticks.load();
+        if (interval > 0) {
+            ss << "到达间隔EWMA: " << HighResolutionTimer::to_ns(interval) << " ns\n";
+        }
+        return ss.str();
+    }
+
+    void reset() {
+        pause_count = 0;
+        pause_ticks = 0;
+        max_pause_ticks = 0;
+        wake_count = 0;
+        wake_ticks = 0;
+        max_wake_ticks = 0;
+        interval_ticks = 0;
+    }
+
+private:
+    std::atomic<size_t> pause_count{0};         // 回退次数
+    std::atomic<uint64_t> pause_ticks{0};       // 回退总时长
+    std::atomic<uint64_t> max_pause_ticks{0};   // 单次最长回退
+    std::atomic<size_t> wake_count{0};          // 从回退中恢复的次数
+    std::atomic<uint64_t> wake_ticks{0};        // 唤醒延迟上界之和
+    std::atomic<uint64_t> max_wake_ticks{0};    // 最大唤醒延迟上界
+    std::atomic<uint64_t> interval_ticks{0};    // 最近的到达间隔EWMA
+
+    static void update_max(std::atomic<uint64_t>& target, uint64_t value) {
+        uint64_t current = target.load();
+        while (value > current && !target.compare_exchange_weak(current, value));
+    }
+};
+
+/**
+ * @brief 按到达间隔自适应的指数回退
+ *
+ * 固定的"从1翻倍到16384次pause"在安静期之后会让突发的第一条消息多等上万次pause。
+ * 这里每次回退的时长仍从 MIN_BACKOFF_NS 起翻倍，但上限与预期的到达间隔挂钩:
+ * - 用 EWMA 跟踪消息到达间隔，每段连续有进展的时间结束时(第一次回退时)更新一次，
+ *   样本为 上一段开始至今的时间 / 期间的消息数，热路径上不读时钟
+ * - 正常情况下单次回退不超过到达间隔的 1/INTERVAL_DIVISOR，唤醒延迟只占间隔的一小部分
+ * - 空闲时间超过 IDLE_FACTOR 倍到达间隔后视为进入安静期，上限随已空闲时间增长
+ *   (同样按 1/INTERVAL_DIVISOR)，最长到 max_backoff_ns，不会一直满速自旋
+ * 还没有样本时上限为 max_backoff_ns，与原来的固定回退一致。
+ *
+ * 不是线程安全的，每个线程各自持有一个。
+ */
+class AdaptiveBackoff {
+public:
+    static constexpr uint64_t MIN_BACKOFF_NS = 20;            // 第一次回退的时长
+    static constexpr uint64_t DEFAULT_MAX_BACKOFF_NS = 100000; // 默认的单次回退上限
+    static constexpr uint64_t INTERVAL_DIVISOR = 8;            // 回退上限占到达间隔的比例的倒数
+    static constexpr uint64_t IDLE_FACTOR = 32;                // 空闲超过多少倍到达间隔视为安静期
+    static constexpr uint64_t EWMA_WEIGHT = 8;                 // EWMA 中新样本的权重为 1/EWMA_WEIGHT
+
+    /**
+     * @param max_backoff_ns 单次回退的上限
+     */
+    explicit AdaptiveBackoff(uint64_t max_backoff_ns = DEFAULT_MAX_BACKOFF_NS)
+        : min_ticks_(ns_to_ticks(MIN_BACKOFF_NS))
+        , max_ticks_(std::max(ns_to_ticks(max_backoff_ns), min_ticks_)) {}
+
+    /**
+     * @brief 记录进展(读到或写入了消息)
+     * @param count 本次处理的消息数
+     * @return 进展前正在回退时返回最后一次回退的时长(唤醒延迟上界)，否则返回0
+     */
+    uint64_t on_progress(size_t count = 1) {
+        arrivals_ += count;
+        if (current_ticks_ == 0) {
+            return 0;
+        }
+        current_ticks_ = 0;
+        return last_pause_ticks_;
+    }
+
+    /**
+     * @brief 没有进展时回退等待一次
+     * @return 本次回退的时长
+     */
+    uint64_t pause() {
+        const uint64_t now = HighResolutionTimer::now();
+        if (current_ticks_ == 0) {
+            // 一段连续进展结束，更新到达间隔
+            if (mark_ != 0 && arrivals_ > 0) {
+                const uint64_t sample = (now - mark_) / arrivals_;
+                if (interval_ticks_ == 0) {
+                    interval_ticks_ = sample;
+                } else if (sample > interval_ticks_) {
+                    interval_ticks_ += (sample - interval_ticks_) / EWMA_WEIGHT;
+                } else {
+                    interval_ticks_ -= (interval_ticks_ - sample) / EWMA_WEIGHT;
+                }
+            }
+            mark_ = now;
+            arrivals_ = 0;
+            idle_start_ = now;
+            current_ticks_ = min_ticks_;
+        } else {
+            current_ticks_ *= 2;
+        }
+        current_ticks_ = std::min(current_ticks_, cap(now));
+
+        const uint64_t deadline = now + current_ticks_;
+        do {
+            #if defined(__x86_64__)
+                _mm_pause();
+            #elif defined(__aarch64__)
+                asm volatile("yield");
+            #endif
+        } while (HighResolutionTimer::now() < deadline);
+
+        last_pause_ticks_ = current_ticks_;
+        return current_ticks_;
+    }
+
+    /**
+     * @brief 回退是否已达到单次上限: 连续空闲已久，继续自旋只是空耗CPU
+     */
+    bool saturated() const {
+        return current_ticks_ >= max_ticks_;
+    }
+
+    /**
+     * @brief 当前的到达间隔EWMA，还没有样本时为0
+     */
+    uint64_t interval_ticks() const {
+        return interval_ticks_;
+    }
+
+private:
+    uint64_t min_ticks_;            // 第一次回退的时长
+    uint64_t max_ticks_;            // 单次回退上限
+    uint64_t current_ticks_ = 0;    // 当前回退时长，0表示不在回退中
+    uint64_t last_pause_ticks_ = 0; // 最近一次回退的时长
+    uint64_t interval_ticks_ = 0;   // 到达间隔EWMA
+    uint64_t mark_ = 0;             // 本段统计的起点
+    uint64_t arrivals_ = 0;         // 本段统计以来的消息数
+    uint64_t idle_start_ = 0;       // 本次空闲的起点
+
+    /**
+     * @brief 本次回退的上限
+     */
+    uint64_t cap(uint64_t now) const {
+        if (interval_ticks_ == 0) {
+            return max_ticks_;
+        }
+        uint64_t bound = interval_ticks_ / INTERVAL_DIVISOR;
+        const uint64_t idle = now - idle_start_;
+        if (idle > interval_ticks_ * IDLE_FACTOR) {
+            bound = std::max(bound, idle / INTERVAL_DIVISOR);
+        }
+        return std::clamp(bound, min_ticks_, max_ticks_);
+    }
+
+    static uint64_t ns_to_ticks(uint64_t ns) {
+        const double ticks_per_ns = 1.0 / HighResolutionTimer::to_ns(1);
+        const auto ticks = static_cast<uint64_t>(static_cast<double>(ns) * ticks_per_ns);
+        return ticks > 0 ? ticks : 1;
+    }
+};
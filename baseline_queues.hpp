@@ -0,0 +1,166 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/**
+ * @brief 基准对照队列
+ *
+ * 这里的几个队列只用于基准测试，与 NBQueue 提供相同的接口:
+ * - bool push(T value): 成功返回true，队列满返回false
+ * - std::optional<T> pop(): 成功返回数据，队列空返回std::nullopt
+ *
+ * 它们代表"最朴素的实现"，用来衡量 NBQueue 相对于常见替代方案的收益，
+ * 并在 NBQueue 退化到比它们更慢时及时发现。
+ */
+
+/**
+ * @brief 基于 std::mutex + std::deque 的有界队列
+ * @tparam T 队列元素类型
+ * @tparam Capacity 队列容量
+ */
+template<typename T, size_t Capacity>
+class MutexQueue {
+    std::mutex mutex_;      // 保护 items_ 的互斥锁
+    std::deque<T> items_;   // 数据存储
+
+public:
+    MutexQueue() = default;
+
+    // 禁用拷贝构造和赋值操作
+    MutexQueue(const MutexQueue&) = delete;
+    MutexQueue& operator=(const MutexQueue&) = delete;
+
+    bool push(T value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.size() >= Capacity) {
+            return false;
+        }
+        items_.push_back(std::move(value));
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+        std::optional<T> result{std::move(items_.front())};
+        items_.pop_front();
+        return result;
+    }
+};
+
+/**
+ * @brief 基于条件变量的阻塞队列
+ * @tparam T 队列元素类型
+ * @tparam Capacity 队列容量
+ *
+ * push在队列满时、pop在队列空时最多阻塞 WAIT_TIMEOUT，
+ * 超时后分别返回false/std::nullopt，以保持与 NBQueue 相同的接口语义。
+ */
+template<typename T, size_t Capacity>
+class BlockingQueue {
+    static constexpr auto WAIT_TIMEOUT = std::chrono::milliseconds(1);
+
+    std::mutex mutex_;                   // 保护 items_ 的互斥锁
+    std::condition_variable not_empty_;  // 队列非空通知
+    std::condition_variable not_full_;   // 队列非满通知
+    std::deque<T> items_;                // 数据存储
+
+public:
+    BlockingQueue() = default;
+
+    // 禁用拷贝构造和赋值操作
+    BlockingQueue(const BlockingQueue&) = delete;
+    BlockingQueue& operator=(const BlockingQueue&) = delete;
+
+    bool push(T value) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!not_full_.wait_for(lock, WAIT_TIMEOUT,
+                                    [this] { return items_.size() < Capacity; })) {
+                return false;
+            }
+            items_.push_back(std::move(value));
+        }
+        not_empty_.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        std::optional<T> result;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!not_empty_.wait_for(lock, WAIT_TIMEOUT,
+                                     [this] { return !items_.empty(); })) {
+                return std::nullopt;
+            }
+            result.emplace(std::move(items_.front()));
+            items_.pop_front();
+        }
+        not_full_.notify_one();
+        return result;
+    }
+};
+
+/**
+ * @brief 单生产者单消费者环形队列
+ * @tparam T 队列元素类型(需要可默认构造)
+ * @tparam Capacity 队列容量(与 NBQueue 一样保留一个空槽位区分满/空)
+ *
+ * 经典的 Lamport 环形缓冲区，生产者和消费者各自缓存对方的索引，
+ * 只在缓存值显示满/空时才去读取对方的原子变量。
+ * 只允许一个生产者线程和一个消费者线程同时使用。
+ */
+template<typename T, size_t Capacity>
+class SpscRingQueue {
+    // 使用64字节对齐以避免伪共享
+    alignas(64) std::array<T, Capacity> buffer_{};
+    alignas(64) std::atomic<size_t> write_index_{0};  // 写入位置索引(生产者独占写)
+    size_t cached_read_index_{0};                     // 生产者缓存的读取位置
+    alignas(64) std::atomic<size_t> read_index_{0};   // 读取位置索引(消费者独占写)
+    size_t cached_write_index_{0};                    // 消费者缓存的写入位置
+
+public:
+    SpscRingQueue() = default;
+
+    // 禁用拷贝构造和赋值操作
+    SpscRingQueue(const SpscRingQueue&) = delete;
+    SpscRingQueue& operator=(const SpscRingQueue&) = delete;
+
+    bool push(T value) {
+        const size_t current_write = write_index_.load(std::memory_order_relaxed);
+        const size_t next_write = (current_write + 1) % Capacity;
+
+        if (next_write == cached_read_index_) {
+            cached_read_index_ = read_index_.load(std::memory_order_acquire);
+            if (next_write == cached_read_index_) {
+                return false;
+            }
+        }
+
+        buffer_[current_write] = std::move(value);
+        write_index_.store(next_write, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> pop() {
+        const size_t current_read = read_index_.load(std::memory_order_relaxed);
+
+        if (current_read == cached_write_index_) {
+            cached_write_index_ = write_index_.load(std::memory_order_acquire);
+            if (current_read == cached_write_index_) {
+                return std::nullopt;
+            }
+        }
+
+        std::optional<T> result{std::move(buffer_[current_read])};
+        read_index_.store((current_read + 1) % Capacity, std::memory_order_release);
+        return result;
+    }
+};
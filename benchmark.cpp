@@ -0,0 +1,371 @@
+#include "queue.hpp"
+#include "baseline_queues.hpp"
+#include "memory_pool.hpp"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#if defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+#include "timer.hpp"
+#include "test_data.hpp"
+
+/**
+ * @brief 基准测试参数
+ */
+constexpr size_t BENCH_QUEUE_CAPACITY = 4096;                 // 队列容量
+constexpr size_t DEFAULT_MESSAGES_PER_PRODUCER = 1000000;     // 每个生产者默认发送的消息数
+constexpr auto RUN_TIMEOUT = std::chrono::seconds(10);        // 单次运行的超时时间
+constexpr size_t POOL_BATCH = 256;                            // 单线程内存池测试每轮连续分配的对象数
+
+/**
+ * @brief 测试场景: 生产者/消费者线程数
+ */
+struct Scenario {
+    const char* name;     // 场景名称
+    size_t producers;     // 生产者线程数
+    size_t consumers;     // 消费者线程数
+};
+
+constexpr Scenario SCENARIOS[] = {
+    {"1P/1C", 1, 1},
+    {"2P/2C", 2, 2},
+    {"4P/1C", 4, 1},
+};
+
+/**
+ * @brief 单次运行的结果
+ */
+struct BenchResult {
+    bool supported = false;      // 队列是否支持该场景
+    bool completed = false;      // 是否在超时前完成
+    size_t consumed = 0;         // 实际消费的消息数
+    size_t push_failures = 0;    // push失败(队列满)次数
+    double elapsed_ms = 0;       // 耗时(毫秒)
+};
+
+static inline void cpu_relax() {
+    #if defined(__x86_64__)
+        _mm_pause();
+    #elif defined(__aarch64__)
+        asm volatile("yield");
+    #endif
+}
+
+/**
+ * @brief 在给定队列上运行相同的生产/消费负载
+ * @tparam Queue 队列类型，需提供 push(T)/pop() 接口
+ * @param scenario 测试场景
+ * @param messages_per_producer 每个生产者发送的消息数
+ */
+template<typename Queue>
+BenchResult run_workload(const Scenario& scenario, size_t messages_per_producer) {
+    auto queue = std::make_unique<Queue>();
+    const size_t total = scenario.producers * messages_per_producer;
+
+    std::atomic<bool> go{false};
+    std::atomic<bool> abort{false};
+    std::atomic<size_t> consumed{0};
+    std::atomic<size_t> push_failures{0};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < scenario.producers; ++p) {
+        threads.emplace_back([&, p]() {
+            while (!go.load(std::memory_order_acquire)) {
+                cpu_relax();
+            }
+            size_t failures = 0;
+            const uint64_t base = static_cast<uint64_t>(p) * messages_per_producer;
+            for (size_t i = 0; i < messages_per_producer; ++i) {
+                while (!queue->push(TestData(base + i))) {
+                    if (abort.load(std::memory_order_relaxed)) {
+                        push_failures += failures;
+                        return;
+                    }
+                    ++failures;
+                    cpu_relax();
+                }
+            }
+            push_failures += failures;
+        });
+    }
+
+    for (size_t c = 0; c < scenario.consumers; ++c) {
+        threads.emplace_back([&]() {
+            while (!go.load(std::memory_order_acquire)) {
+                cpu_relax();
+            }
+            while (consumed.load(std::memory_order_relaxed) < total &&
+                   !abort.load(std::memory_order_relaxed)) {
+                if (queue->pop()) {
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    cpu_relax();
+                }
+            }
+        });
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + RUN_TIMEOUT;
+    const auto start_count = HighResolutionTimer::now();
+    go.store(true, std::memory_order_release);
+
+    while (consumed.load(std::memory_order_relaxed) < total) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            abort.store(true);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const auto end_count = HighResolutionTimer::now();
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    BenchResult result;
+    result.supported = true;
+    result.completed = !abort.load();
+    result.consumed = consumed.load();
+    result.push_failures = push_failures.load();
+    result.elapsed_ms = HighResolutionTimer::to_ms(end_count - start_count);
+    return result;
+}
+
+/**
+ * @brief 一种队列实现在所有场景下的结果
+ */
+struct QueueResults {
+    std::string name;
+    std::vector<BenchResult> results;
+};
+
+/**
+ * @brief 在所有场景下测试一种队列实现
+ * @tparam Queue 队列类型
+ * @param name 队列名称
+ * @param single_producer_consumer 是否只支持单生产者单消费者
+ */
+template<typename Queue>
+QueueResults bench_queue(const std::string& name, bool single_producer_consumer,
+                         size_t messages_per_producer) {
+    QueueResults queue_results{name, {}};
+    for (const auto& scenario : SCENARIOS) {
+        if (single_producer_consumer && (scenario.producers > 1 || scenario.consumers > 1)) {
+            queue_results.results.emplace_back();
+            continue;
+        }
+        std::cout << "运行 " << name << " " << scenario.name << " ..." << std::endl;
+        queue_results.results.push_back(run_workload<Queue>(scenario, messages_per_producer));
+    }
+    return queue_results;
+}
+
+/**
+ * @brief 并排输出所有队列的测试结果
+ */
+void print_results(const std::vector<QueueResults>& all) {
+    constexpr int NAME_WIDTH = 16;
+    constexpr int COLUMN_WIDTH = 26;
+
+    std::cout << "\n=== 队列吞吐量对比 (Mops/s, ns/消息) ===\n";
+    std::cout << std::left << std::setw(NAME_WIDTH) << "队列";
+    for (const auto& scenario : SCENARIOS) {
+        std::cout << std::setw(COLUMN_WIDTH) << scenario.name;
+    }
+    std::cout << "\n";
+
+    for (const auto& queue_results : all) {
+        std::cout << std::setw(NAME_WIDTH) << queue_results.name;
+        for (const auto& r : queue_results.results) {
+            std::stringstream cell;
+            if (!r.supported) {
+                cell << "N/A";
+            } else if (r.consumed == 0) {
+                cell << "超时";
+            } else {
+                const double ops_per_ms = r.consumed / r.elapsed_ms;
+                cell << std::fixed << std::setprecision(2) << ops_per_ms / 1000.0 << " / "
+                     << std::setprecision(1) << 1000000.0 / ops_per_ms;
+                if (!r.completed) {
+                    cell << " (超时)";
+                }
+            }
+            std::cout << std::setw(COLUMN_WIDTH) << cell.str();
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << "\n=== push失败(队列满)次数 ===\n";
+    for (const auto& queue_results : all) {
+        std::cout << std::setw(NAME_WIDTH) << queue_results.name;
+        for (const auto& r : queue_results.results) {
+            std::cout << std::setw(COLUMN_WIDTH)
+                      << (r.supported ? std::to_string(r.push_failures) : std::string("N/A"));
+        }
+        std::cout << "\n";
+    }
+}
+
+/**
+ * @brief 内存池基准测试的分配器适配: 统一为 allocate()/deallocate(T*)
+ */
+template<typename T>
+struct HeapAllocator {
+    T* allocate() { return new T(); }
+    void deallocate(T* obj) { delete obj; }
+};
+
+/**
+ * @brief 加锁的 MemoryPool，作为跨线程分配、释放时的对照
+ */
+template<typename T>
+struct LockedMemoryPool {
+    MemoryPool<T> pool{1024, -1, false};
+    std::mutex mutex;
+
+    T* allocate() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pool.allocate();
+    }
+
+    void deallocate(T* obj) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pool.deallocate(obj);
+    }
+};
+
+/**
+ * @brief 单线程: 每轮连续分配 POOL_BATCH 个对象再全部释放
+ * @return 每次分配+释放的平均耗时(ns)
+ */
+template<typename Allocator>
+double bench_pool_single(Allocator& allocator, size_t operations) {
+    std::vector<TestData*> objects(POOL_BATCH);
+    const size_t rounds = std::max<size_t>(operations / POOL_BATCH, 1);
+    const auto start_count = HighResolutionTimer::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < POOL_BATCH; ++i) {
+            objects[i] = allocator.allocate();
+            objects[i]->sequence = i;
+        }
+        for (size_t i = 0; i < POOL_BATCH; ++i) {
+            allocator.deallocate(objects[i]);
+        }
+    }
+    const auto end_count = HighResolutionTimer::now();
+    return HighResolutionTimer::to_ms(end_count - start_count) * 1000000.0 / (rounds * POOL_BATCH);
+}
+
+/**
+ * @brief 生产者分配、经 SPSC 队列传递指针、消费者释放
+ * @return 每个对象(分配+传递+释放)的平均耗时(ns)
+ */
+template<typename Allocator>
+double bench_pool_handoff(Allocator& allocator, size_t operations) {
+    auto queue = std::make_unique<SpscRingQueue<TestData*, BENCH_QUEUE_CAPACITY>>();
+    std::atomic<bool> go{false};
+
+    std::thread consumer([&]() {
+        while (!go.load(std::memory_order_acquire)) {
+            cpu_relax();
+        }
+        for (size_t consumed = 0; consumed < operations;) {
+            if (auto obj = queue->pop()) {
+                allocator.deallocate(*obj);
+                ++consumed;
+            } else {
+                cpu_relax();
+            }
+        }
+    });
+
+    const auto start_count = HighResolutionTimer::now();
+    go.store(true, std::memory_order_release);
+    for (size_t i = 0; i < operations; ++i) {
+        TestData* obj = allocator.allocate();
+        obj->sequence = i;
+        while (!queue->push(obj)) {
+            cpu_relax();
+        }
+    }
+    consumer.join();
+    const auto end_count = HighResolutionTimer::now();
+    return HighResolutionTimer::to_ms(end_count - start_count) * 1000000.0 / operations;
+}
+
+/**
+ * @brief 对比 MemoryPool、ConcurrentMemoryPool 与 new/delete
+ *
+ * MemoryPool 不是线程安全的，跨线程场景加锁后参与对比。
+ */
+void bench_memory_pools(size_t operations) {
+    constexpr int NAME_WIDTH = 32;
+    std::cout << "\n=== 内存池对比 (ns/对象) ===\n";
+    std::cout << std::left << std::setw(NAME_WIDTH) << "分配器"
+              << std::setw(16) << "单线程" << "生产者->消费者" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    {
+        MemoryPool<TestData> single(1024, -1, false);
+        LockedMemoryPool<TestData> handoff;
+        const double single_ns = bench_pool_single(single, operations);
+        const double handoff_ns = bench_pool_handoff(handoff, operations);
+        std::cout << std::setw(NAME_WIDTH) << "MemoryPool(跨线程加锁)"
+                  << std::setw(16) << single_ns << handoff_ns << "\n";
+    }
+    {
+        ConcurrentMemoryPool<TestData> pool(1024, -1, false);
+        const double single_ns = bench_pool_single(pool, operations);
+        const double handoff_ns = bench_pool_handoff(pool, operations);
+        std::cout << std::setw(NAME_WIDTH) << "ConcurrentMemoryPool"
+                  << std::setw(16) << single_ns << handoff_ns << "\n";
+    }
+    {
+        HeapAllocator<TestData> heap;
+        const double single_ns = bench_pool_single(heap, operations);
+        const double handoff_ns = bench_pool_handoff(heap, operations);
+        std::cout << std::setw(NAME_WIDTH) << "new/delete"
+                  << std::setw(16) << single_ns << handoff_ns << "\n";
+    }
+}
+
+/**
+ * @brief 用法: queue_bench [每个生产者的消息数]
+ */
+int main(int argc, char** argv) {
+    // 初始化高精度计时器
+    HighResolutionTimer::init();
+
+    size_t messages_per_producer = DEFAULT_MESSAGES_PER_PRODUCER;
+    if (argc > 1) {
+        messages_per_producer = std::strtoull(argv[1], nullptr, 10);
+    }
+
+    std::cout << "每个生产者消息数: " << messages_per_producer
+              << ", 队列容量: " << BENCH_QUEUE_CAPACITY << "\n";
+#if QUEUE_PERF_STATS
+    std::cout << "注意: NBQueue 启用了性能统计(QUEUE_PERF_STATS)，结果包含统计开销\n";
+#endif
+
+    using Data = TestData;
+    constexpr size_t Cap = BENCH_QUEUE_CAPACITY;
+
+    std::vector<QueueResults> all;
+    all.push_back(bench_queue<NBQueue<Data, Cap>>("NBQueue", false, messages_per_producer));
+    all.push_back(bench_queue<MutexQueue<Data, Cap>>("MutexQueue", false, messages_per_producer));
+    all.push_back(bench_queue<BlockingQueue<Data, Cap>>("BlockingQueue", false, messages_per_producer));
+    all.push_back(bench_queue<SpscRingQueue<Data, Cap>>("SpscRingQueue", true, messages_per_producer));
+
+    print_results(all);
+    bench_memory_pools(messages_per_producer);
+    return 0;
+}
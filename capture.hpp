@@ -0,0 +1,313 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include "timer.hpp"
+#include "send_schedule.hpp"
+#include "lock_free_queue_reader.hpp"
+
+/**
+ * @brief 流量录制文件头
+ *
+ * 文件格式(小端):
+ * - CaptureFileHeader
+ * - record_count 条记录，每条为 uint64_t 计数器时间戳 + T 的原始字节，紧密排列
+ * 时间戳是录制机器上的计数器原始值，配合 ticks_per_sec 换算成时间，回放时不依赖两台机器的TSC频率相同。
+ */
+struct CaptureFileHeader {
+    static constexpr char MAGIC[8] = {'N', 'B', 'Q', 'C', 'A', 'P', 'T', '1'};
+
+    char magic[8];            // 魔数
+    uint32_t record_size;     // 单条记录字节数
+    uint32_t payload_size;    // 消息字节数，即 sizeof(T)
+    double ticks_per_sec;     // 录制机器上计数器每秒的计数
+    uint64_t record_count;    // 记录数，close() 时回填
+};
+
+/**
+ * @brief 流量录制文件写入器
+ * @tparam T 消息类型，必须可平凡复制，按原始字节写入
+ *
+ * 通过带大缓冲区的 stdio 顺序写入，不是线程安全的，由单个线程独占。
+ * 写入错误(如磁盘已满)多数在缓冲区刷出时才发生，可能由之后的 write() 或 close() 报告。
+ */
+template<typename T>
+class CaptureWriter {
+    static_assert(std::is_trivially_copyable_v<T>, "录制文件按原始字节保存消息，T 必须可平凡复制");
+
+public:
+    static constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;   // 写缓冲区大小
+
+    /**
+     * @brief 创建录制文件
+     * @param path 文件路径，已存在时会被覆盖
+     * @throw std::system_error 打开文件或写入文件头失败
+     */
+    explicit CaptureWriter(const std::string& path)
+        : buffer_(WRITE_BUFFER_SIZE) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            throw std::system_error(errno, std::generic_category(), "fopen " + path);
+        }
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+
+        std::memcpy(header_.magic, CaptureFileHeader::MAGIC, sizeof(header_.magic));
+        header_.record_size = static_cast<uint32_t>(sizeof(uint64_t) + sizeof(T));
+        header_.payload_size = static_cast<uint32_t>(sizeof(T));
+        header_.ticks_per_sec = 1.0 / HighResolutionTimer::to_sec(1);
+        header_.record_count = 0;
+        if (std::fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+            const int error = errno;
+            std::fclose(file_);
+            throw std::system_error(error, std::generic_category(), "fwrite " + path);
+        }
+    }
+
+    /**
+     * @brief 析构函数，回填记录数并关闭文件
+     *
+     * 析构时写入失败无法上报，需要确认录制完整时先显式调用 close()。
+     */
+    ~CaptureWriter() {
+        try {
+            close();
+        } catch (const std::system_error&) {
+        }
+    }
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /**
+     * @brief 写入一条记录
+     * @param ticks 计数器时间戳
+     * @param value 消息
+     * @throw std::system_error 写入失败，该条记录不计入记录数
+     */
+    void write(uint64_t ticks, const T& value) {
+        if (std::fwrite(&ticks, sizeof(ticks), 1, file_) != 1 ||
+            std::fwrite(&value, sizeof(T), 1, file_) != 1) {
+            throw std::system_error(errno, std::generic_category(), "fwrite");
+        }
+        header_.record_count++;
+    }
+
+    /**
+     * @brief 已写入的记录数
+     */
+    uint64_t record_count() const {
+        return header_.record_count;
+    }
+
+    /**
+     * @brief 回填记录数并关闭文件
+     * @throw std::system_error 刷出缓冲区、回填文件头或关闭失败，文件不完整；文件仍会被关闭
+     */
+    void close() {
+        if (!file_) {
+            return;
+        }
+        std::FILE* file = file_;
+        file_ = nullptr;
+        // fseek 先刷出缓冲区中的记录
+        const char* failed = nullptr;
+        if (std::fseek(file, 0, SEEK_SET) != 0) {
+            failed = "fseek";
+        } else if (std::fwrite(&header_, sizeof(header_), 1, file) != 1) {
+            failed = "fwrite";
+        }
+        const int error = errno;
+        if (std::fclose(file) != 0 && failed == nullptr) {
+            throw std::system_error(errno, std::generic_category(), "fclose");
+        }
+        if (failed != nullptr) {
+            throw std::system_error(error, std::generic_category(), failed);
+        }
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffer_;     // stdio 写缓冲区
+    CaptureFileHeader header_{};
+};
+
+/**
+ * @brief 把队列中观察到的消息连同观察时间录制到文件的读取器
+ * @tparam T 数据类型
+ * @tparam Capacity 队列容量
+ *
+ * 时间戳是读取器看到消息的时间，比发布时间晚一个读取延迟，但相邻消息的间隔(突发形状)基本保持。
+ * 停止后调用 writer 的 close() 或销毁 writer 完成文件。
+ *
+ * 写入失败后不再写入，failed() 变为true，异常由 error() 取出(与 JournalReader 一致)。
+ */
+template<typename T, size_t Capacity>
+class CaptureReader : public LockFreeQueueReader<CaptureReader<T, Capacity>, T, Capacity> {
+private:
+    using Base = LockFreeQueueReader<CaptureReader<T, Capacity>, T, Capacity>;
+    friend Base;  // 允许基类访问on_data
+
+    CaptureWriter<T>& writer_;
+    std::atomic<bool> failed_{false};        // 写入已失败
+    std::exception_ptr error_;               // 第一次失败的异常，failed_ 置位之前写入
+
+    void on_data(const T& data) {
+        if (failed_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            writer_.write(HighResolutionTimer::now(), data);
+        } catch (const std::exception&) {
+            error_ = std::current_exception();
+            failed_.store(true, std::memory_order_release);
+        }
+    }
+
+public:
+    CaptureReader(NBQueue<T, Capacity>& queue, CaptureWriter<T>& writer)
+        : Base(queue), writer_(writer) {}
+
+    /**
+     * @brief 写入是否已失败
+     */
+    bool failed() const {
+        return failed_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 第一次失败的异常，没有失败时为空，需在 failed() 返回true之后读取
+     */
+    std::exception_ptr error() const {
+        return failed() ? error_ : nullptr;
+    }
+};
+
+/**
+ * @brief 加载到内存中的流量录制，用于按原始节奏回放
+ * @tparam T 消息类型
+ *
+ * 用法:
+ *   auto capture = TrafficCapture<TestData>::load("burst.cap");
+ *   LockFreeQueueProducer producer(queue, capture.generator());
+ *   producer.set_send_schedule(capture.schedule(2.0));   // 2倍速回放
+ * 生成器和发送计划都到末尾后从头循环，两者每条消息各推进一次，始终保持对应。
+ * 生成器只依赖 NBQueue 和普通生产者接口，因此可以接入任意队列拓扑(包括路由生产者)。
+ */
+template<typename T>
+class TrafficCapture {
+    static_assert(std::is_trivially_copyable_v<T>, "录制文件按原始字节保存消息，T 必须可平凡复制");
+
+public:
+    /**
+     * @brief 加载录制文件
+     * @throw std::system_error 打开文件失败
+     * @throw std::runtime_error 文件格式与 T 不匹配、文件为空或被截断
+     */
+    static TrafficCapture load(const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            throw std::system_error(errno, std::generic_category(), "fopen " + path);
+        }
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> guard(file, &std::fclose);
+
+        CaptureFileHeader header{};
+        if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+            std::memcmp(header.magic, CaptureFileHeader::MAGIC, sizeof(header.magic)) != 0 ||
+            header.payload_size != sizeof(T) ||
+            header.record_size != sizeof(uint64_t) + sizeof(T) ||
+            header.ticks_per_sec <= 0) {
+            throw std::runtime_error("录制文件格式与消息类型不匹配: " + path);
+        }
+        if (header.record_count == 0) {
+            throw std::runtime_error("录制文件为空: " + path);
+        }
+        // 记录数来自文件，先与文件大小核对，避免按损坏的记录数预留内存
+        struct stat st {};
+        if (::fstat(::fileno(file), &st) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat " + path);
+        }
+        const uint64_t body_size = static_cast<uint64_t>(st.st_size) - sizeof(header);
+        if (header.record_count > body_size / header.record_size) {
+            throw std::runtime_error("录制文件被截断: " + path);
+        }
+
+        TrafficCapture capture;
+        capture.ticks_per_sec_ = header.ticks_per_sec;
+        capture.ticks_.reserve(header.record_count);
+        auto records = std::make_shared<std::vector<T>>();
+        records->reserve(header.record_count);
+        for (uint64_t i = 0; i < header.record_count; ++i) {
+            uint64_t ticks = 0;
+            T value;
+            if (std::fread(&ticks, sizeof(ticks), 1, file) != 1 ||
+                std::fread(&value, sizeof(T), 1, file) != 1) {
+                throw std::runtime_error("录制文件被截断: " + path);
+            }
+            capture.ticks_.push_back(ticks);
+            records->push_back(value);
+        }
+        capture.records_ = std::move(records);
+        return capture;
+    }
+
+    size_t size() const { return records_->size(); }
+    bool empty() const { return records_->empty(); }
+
+    /**
+     * @brief 录制的时长(秒)
+     */
+    double duration_sec() const {
+        return ticks_.size() < 2 ? 0.0 : (ticks_.back() - ticks_.front()) / ticks_per_sec_;
+    }
+
+    /**
+     * @brief 按录制的到达间隔生成发送计划
+     * @param speed 回放倍速，1表示原始节奏，2表示间隔减半；小于等于0表示全速闭环发送
+     *
+     * 最后一条消息之后的间隔取平均间隔，循环回放时衔接自然。
+     */
+    SendSchedule schedule(double speed = 1.0) const {
+        if (speed <= 0 || ticks_.empty()) {
+            return SendSchedule::saturate();
+        }
+        const double scale = (1.0 / HighResolutionTimer::to_sec(1)) / ticks_per_sec_ / speed;
+        auto intervals = std::make_shared<std::vector<double>>();
+        intervals->reserve(ticks_.size());
+        for (size_t i = 1; i < ticks_.size(); ++i) {
+            intervals->push_back(static_cast<double>(ticks_[i] - ticks_[i - 1]) * scale);
+        }
+        intervals->push_back(ticks_.size() > 1
+            ? static_cast<double>(ticks_.back() - ticks_.front()) * scale / (ticks_.size() - 1)
+            : 0.0);
+        return SendSchedule::replay(std::move(intervals));
+    }
+
+    /**
+     * @brief 依次返回录制消息的生成器，到末尾后从头循环
+     *
+     * 生成器共享录制数据，可以复制给多个生产者，各自独立从头开始。
+     */
+    auto generator() const {
+        return [records = records_, index = size_t{0}]() mutable {
+            const T& value = (*records)[index];
+            index = (index + 1) % records->size();
+            return value;
+        };
+    }
+
+private:
+    double ticks_per_sec_ = 1.0;                     // 录制机器上计数器每秒的计数
+    std::vector<uint64_t> ticks_;                    // 各条消息的录制时间戳
+    std::shared_ptr<const std::vector<T>> records_ = std::make_shared<const std::vector<T>>();
+};
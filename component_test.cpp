@@ -0,0 +1,965 @@
+#include "queue.hpp"
+#include "routing_producer.hpp"
+#include "lock_free_queue_producer.hpp"
+#include "lock_free_queue_consumer.hpp"
+#include "journal.hpp"
+#include "pipeline.hpp"
+#include "reader_executor.hpp"
+#include "capture.hpp"
+#include "queue_notifier.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <atomic>
+#include <optional>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "timer.hpp"
+
+/**
+ * @brief 组件测试: 实例化并运行主程序没有覆盖的组件和策略，保证它们随构建一起编译并按文档工作
+ */
+constexpr int TIMEOUT_SEC = 30;       // 等待条件成立的最长时间
+
+/**
+ * @brief 等待条件成立，超时返回false
+ */
+template<typename Predicate>
+static bool wait_until(Predicate&& predicate) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(TIMEOUT_SEC);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ * @brief 打印一项检查的结果
+ */
+static bool check(const char* name, bool ok) {
+    std::cout << "  " << name << (ok ? " 通过" : " 失败") << "\n";
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// RoutingQueueProducer
+// ---------------------------------------------------------------------------
+
+constexpr size_t ROUTING_QUEUE_CAPACITY = 8;      // 每个分片队列可容纳 7 条
+constexpr size_t ROUTING_STAGING_CAPACITY = 2;    // 每个分片的暂存容量
+constexpr int ROUTING_SHARDS = 2;
+constexpr int ROUTING_CHECKED = 64;               // 重新启动后每个分片校验的消息数
+
+using RoutingQueue = NBQueue<int, ROUTING_QUEUE_CAPACITY>;
+
+/**
+ * @brief 生成连续整数，计数器由测试线程观察
+ */
+struct CountingGenerator {
+    std::atomic<int>* next;
+
+    int operator()() {
+        return next->fetch_add(1);
+    }
+};
+
+/**
+ * @brief 按奇偶分片，哈希取恒等，分片结果与标准库实现无关
+ */
+struct ParityKey {
+    int operator()(const int& value) const {
+        return value % ROUTING_SHARDS;
+    }
+};
+
+struct IdentityHash {
+    size_t operator()(int key) const {
+        return static_cast<size_t>(key);
+    }
+};
+
+using TestRoutingProducer =
+    RoutingQueueProducer<int, ROUTING_QUEUE_CAPACITY, CountingGenerator, ParityKey, IdentityHash>;
+
+static bool test_routing_producer() {
+    std::cout << "RoutingQueueProducer:\n";
+    bool ok = true;
+
+    std::atomic<int> next{0};
+    bool rejected = false;
+    try {
+        TestRoutingProducer empty({}, CountingGenerator{&next}, ParityKey{});
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ok &= check("没有分片队列时构造失败", rejected);
+
+    RoutingQueue queues[ROUTING_SHARDS];
+    TestRoutingProducer producer({&queues[0], &queues[1]}, CountingGenerator{&next}, ParityKey{},
+                                 ROUTING_STAGING_CAPACITY);
+
+    // 没有消费者: 分片0的队列和暂存区先满(0..16)，第 18 号消息被持有，生成暂停
+    producer.start();
+    const int accepted_per_shard = static_cast<int>(ROUTING_QUEUE_CAPACITY - 1 + ROUTING_STAGING_CAPACITY);
+    const int generated = accepted_per_shard * ROUTING_SHARDS + 1;
+    ok &= check("两个分片都满后生成暂停", wait_until([&]() { return next.load() == generated; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    producer.stop();
+    ok &= check("暂停期间不再生成", next.load() == generated);
+    ok &= check("停止后持有的消息保留", producer.has_pending());
+    ok &= check("停止后暂存的消息保留",
+                producer.staged_count(0) == ROUTING_STAGING_CAPACITY &&
+                producer.staged_count(1) == ROUTING_STAGING_CAPACITY);
+
+    // 重新启动并消费: 每个分片应按顺序收到全部同奇偶的消息，持有的和暂存的都不丢
+    producer.start();
+    bool ordered = true;
+    int expected[ROUTING_SHARDS] = {0, 1};
+    const bool received = wait_until([&]() {
+        bool done = true;
+        for (int shard = 0; shard < ROUTING_SHARDS; ++shard) {
+            while (auto value = queues[shard].pop()) {
+                ordered &= *value == expected[shard];
+                expected[shard] += ROUTING_SHARDS;
+            }
+            done &= expected[shard] >= ROUTING_CHECKED * ROUTING_SHARDS;
+        }
+        return done;
+    });
+    producer.stop();
+    ordered &= received;
+    ok &= check("重新启动后各分片按序收到全部消息", ordered);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// LockFreeQueueProducer 停止时保留未发布的消息
+// ---------------------------------------------------------------------------
+
+constexpr size_t HELD_QUEUE_CAPACITY = 8;         // 队列可容纳 7 条
+constexpr size_t HELD_STAGING_CAPACITY = 4;
+constexpr size_t HELD_BATCH_SIZE = 5;             // 第二批只能写入 2 条，剩余 3 条未发布
+constexpr int HELD_CHECKED = 64;                  // 重新启动后校验的消息数
+
+using HeldQueue = NBQueue<int, HELD_QUEUE_CAPACITY>;
+
+/**
+ * @brief 每次填满整批连续整数的批量生成器
+ */
+struct CountingBatchGenerator {
+    std::atomic<int>* next;
+
+    size_t operator()(Span<int> batch) {
+        for (auto& value : batch) {
+            value = next->fetch_add(1);
+        }
+        return batch.size();
+    }
+};
+
+/**
+ * @brief 没有消费者时启动生产者，等生成暂停后停止，检查保留的消息，再启动并按序消费
+ * @param generated 队列满后生成器被调用的总条数
+ * @param held 停止后检查保留状态
+ */
+template<typename Producer, typename Held>
+static bool run_held_case(HeldQueue& queue, Producer& producer, std::atomic<int>& next,
+                          int generated, Held&& held) {
+    bool ok = true;
+    producer.start();
+    ok &= wait_until([&]() { return next.load() == generated; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    producer.stop();
+    ok &= next.load() == generated;
+    ok &= held();
+
+    producer.start();
+    bool ordered = true;
+    int expected = 0;
+    ok &= wait_until([&]() {
+        while (auto value = queue.pop()) {
+            ordered &= *value == expected;
+            expected++;
+        }
+        return expected >= HELD_CHECKED;
+    });
+    producer.stop();
+    return ok && ordered;
+}
+
+/**
+ * @brief 统计队列满回调次数
+ */
+struct QueueFullCounter {
+    std::atomic<int>* count;
+
+    void operator()() {
+        count->fetch_add(1);
+    }
+};
+
+static bool test_producer_held() {
+    std::cout << "LockFreeQueueProducer 停止与重启:\n";
+    bool ok = true;
+    const int queue_size = static_cast<int>(HELD_QUEUE_CAPACITY - 1);
+
+    {
+        HeldQueue queue;
+        std::atomic<int> next{0};
+        LockFreeQueueProducer producer(queue, CountingGenerator{&next});
+        ok &= check("Block: 停止时正在重试的消息保留并最先发布",
+                    run_held_case(queue, producer, next, queue_size + 1, [&]() {
+                        return producer.has_pending() && producer.pending_count() == 1;
+                    }));
+    }
+    {
+        HeldQueue queue;
+        std::atomic<int> next{0};
+        LockFreeQueueProducer producer(queue, CountingGenerator{&next});
+        producer.set_staging_capacity(HELD_STAGING_CAPACITY);
+        ok &= check("Block + 暂存区: 暂存的消息保留并按序补发",
+                    run_held_case(queue, producer, next, queue_size + static_cast<int>(HELD_STAGING_CAPACITY), [&]() {
+                        return producer.staged_count() == HELD_STAGING_CAPACITY && !producer.has_pending();
+                    }));
+    }
+    {
+        HeldQueue queue;
+        std::atomic<int> next{0};
+        LockFreeQueueProducer producer(queue, CountingGenerator{&next});
+        producer.set_send_schedule(SendSchedule::fixed_rate(100000.0));
+        ok &= check("开环模式: 停止时正在重试的消息保留",
+                    run_held_case(queue, producer, next, queue_size + 1, [&]() {
+                        return producer.pending_count() == 1;
+                    }));
+    }
+    {
+        // 没有消费者时队列一直满，是同一次背压: 回调只调用一次
+        HeldQueue queue;
+        std::atomic<int> next{0};
+        std::atomic<int> full_count{0};
+        LockFreeQueueProducer producer(queue, CountingGenerator{&next}, QueueFullCounter{&full_count});
+        producer.set_send_schedule(SendSchedule::fixed_rate(100000.0));
+        producer.set_overflow_policy(OverflowPolicy::DropNewest);
+        producer.start();
+        const bool dropping = wait_until([&]() { return next.load() >= HELD_CHECKED; });
+        producer.stop();
+        ok &= check("开环模式: 一次背压期间队列满回调只调用一次", dropping && full_count.load() == 1);
+    }
+    {
+        HeldQueue queue;
+        std::atomic<int> next{0};
+        LockFreeQueueProducer producer(queue, CountingBatchGenerator{&next});
+        producer.set_batch_size(HELD_BATCH_SIZE);
+        const int batches = (queue_size + static_cast<int>(HELD_BATCH_SIZE) - 1) / static_cast<int>(HELD_BATCH_SIZE);
+        const int generated = batches * static_cast<int>(HELD_BATCH_SIZE);
+        ok &= check("批量生成: 未发布的剩余部分保留",
+                    run_held_case(queue, producer, next, generated, [&]() {
+                        return producer.pending_count() == static_cast<size_t>(generated - queue_size);
+                    }));
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// LockFreeQueueProducer 的 Spill 策略
+// ---------------------------------------------------------------------------
+
+constexpr size_t SPILL_QUEUE_CAPACITY = 8;        // 队列可容纳 7 条，突发的其余部分进入溢出文件
+constexpr size_t SPILL_BURST = 64;                // 突发的消息数，等于默认批量大小
+constexpr size_t SPILL_FILE_CAPACITY = 128;       // 溢出文件容量
+constexpr size_t SPILL_FULL_CAPACITY = 4;         // 很快就会写满的溢出文件容量
+
+/**
+ * @brief 先产生一次突发，之后一直没有数据的批量生成器
+ */
+struct BurstGenerator {
+    bool fired = false;
+
+    size_t operator()(Span<int> batch) {
+        if (fired) {
+            return 0;
+        }
+        fired = true;
+        const size_t count = std::min(batch.size(), SPILL_BURST);
+        for (size_t i = 0; i < count; ++i) {
+            batch[i] = static_cast<int>(i);
+        }
+        return count;
+    }
+};
+
+static bool test_spill_restore() {
+    std::cout << "LockFreeQueueProducer Spill:\n";
+    bool ok = true;
+
+    NBQueue<int, SPILL_QUEUE_CAPACITY> queue;
+    LockFreeQueueProducer producer(queue, BurstGenerator{});
+    producer.set_overflow_policy(OverflowPolicy::Spill);
+    producer.set_spill_file("component_test.spill", SPILL_FILE_CAPACITY);
+    producer.start();
+
+    // 生成器之后一直返回0，溢出文件中的消息也要随队列腾出空间补回
+    bool ordered = true;
+    int expected = 0;
+    const bool received = wait_until([&]() {
+        while (auto value = queue.pop()) {
+            ordered &= *value == expected;
+            expected++;
+        }
+        return expected == static_cast<int>(SPILL_BURST);
+    });
+    producer.stop();
+    ok &= check("生成器空闲时溢出的消息按序补回", received && ordered);
+    ok &= check("溢出文件已清空", producer.spilled_count() == 0);
+
+    {
+        // 溢出文件也满时停止: 正在等待的消息保留，不丢弃
+        HeldQueue held_queue;
+        std::atomic<int> next{0};
+        LockFreeQueueProducer held_producer(held_queue, CountingGenerator{&next});
+        held_producer.set_overflow_policy(OverflowPolicy::Spill);
+        held_producer.set_spill_file("component_test_full.spill", SPILL_FULL_CAPACITY);
+        const int generated = static_cast<int>(HELD_QUEUE_CAPACITY - 1 + SPILL_FULL_CAPACITY) + 1;
+        ok &= check("溢出文件满时停止，消息保留并按序发布",
+                    run_held_case(held_queue, held_producer, next, generated, [&]() {
+                        return held_producer.pending_count() == 1 &&
+                               held_producer.spilled_count() == SPILL_FULL_CAPACITY;
+                    }));
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Journal / JournalReader
+// ---------------------------------------------------------------------------
+
+constexpr size_t JOURNAL_QUEUE_CAPACITY = 16;
+constexpr size_t JOURNAL_SEGMENT_SIZE = 8192;     // 段很小，写入过程中会多次切换段
+constexpr uint64_t JOURNAL_MESSAGES = 5000;       // 每个场景写入的消息数
+constexpr uint64_t JOURNAL_SYNC_INTERVAL_US = 20000;  // 按时间落盘场景的落盘间隔
+
+using JournalQueue = NBQueue<uint64_t, JOURNAL_QUEUE_CAPACITY>;
+
+/**
+ * @brief 创建唯一的临时目录
+ */
+static std::string make_temp_directory() {
+    char path[] = "component_test_journal.XXXXXX";
+    if (::mkdtemp(path) == nullptr) {
+        throw std::system_error(errno, std::generic_category(), "mkdtemp");
+    }
+    return path;
+}
+
+/**
+ * @brief 删除目录及其中的文件(不递归)
+ */
+static void remove_directory(const std::string& path) {
+    if (DIR* dir = ::opendir(path.c_str())) {
+        while (dirent* entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                ::unlink((path + "/" + name).c_str());
+            }
+        }
+        ::closedir(dir);
+    }
+    ::rmdir(path.c_str());
+}
+
+/**
+ * @brief 校验日志内容: 序号 s 处要么是队列序号为 s - 1 的消息，要么是空洞记录
+ */
+struct JournalCheck {
+    uint64_t next = 1;          // 下一个期望的日志序号
+    uint64_t messages = 0;
+    uint64_t holes = 0;
+    bool ordered = true;
+
+    void operator()(uint64_t sequence, const uint64_t& value) {
+        ordered &= sequence == next && value == sequence - 1;
+        next = sequence + 1;
+        messages++;
+    }
+
+    void operator()(uint64_t sequence, std::nullptr_t) {
+        ordered &= sequence == next;
+        next = sequence + 1;
+        holes++;
+    }
+};
+
+/**
+ * @brief 在日志写入之后才取走消息的消费者
+ */
+class JournaledConsumer : public LockFreeQueueConsumer<JournaledConsumer, uint64_t, JOURNAL_QUEUE_CAPACITY> {
+    using Base = LockFreeQueueConsumer<JournaledConsumer, uint64_t, JOURNAL_QUEUE_CAPACITY>;
+    friend Base;
+
+    void on_data(uint64_t&& value) {
+        consumed.store(value + 1, std::memory_order_release);
+    }
+
+public:
+    std::atomic<uint64_t> consumed{0};
+
+    explicit JournaledConsumer(JournalQueue& queue) : Base(queue) {}
+};
+
+static bool test_journal() {
+    std::cout << "Journal / JournalReader:\n";
+    bool ok = true;
+    const std::string directory = make_temp_directory();
+    JournalOptions options;
+    options.directory = directory;
+    options.segment_size = JOURNAL_SEGMENT_SIZE;
+    options.sync_mode = JournalSyncMode::None;
+
+    {
+        // 消费者依赖日志读取器的进度，日志不丢消息；写入期间在本线程并发重放
+        Journal<uint64_t> journal(options);
+        JournalQueue queue;
+        JournalReader<uint64_t, JOURNAL_QUEUE_CAPACITY> journal_reader(queue, journal);
+        JournaledConsumer consumer(queue);
+        consumer.depends_on(journal_reader.cursor());
+        journal_reader.start();
+        consumer.start();
+
+        bool replay_ordered = true;
+        for (uint64_t i = 0; i < JOURNAL_MESSAGES; ++i) {
+            while (!queue.try_push(i)) {
+                std::this_thread::yield();
+            }
+            if (i % 1000 == 0) {
+                JournalCheck snapshot;
+                journal.replay(1, snapshot);
+                replay_ordered &= snapshot.ordered && snapshot.holes == 0;
+            }
+        }
+        ok &= check("消费者取走全部消息",
+                    wait_until([&]() { return consumer.consumed.load() == JOURNAL_MESSAGES; }));
+        consumer.stop();
+        journal_reader.stop();
+        ok &= check("写入期间并发重放结果连续", replay_ordered);
+
+        JournalCheck check_all;
+        journal.replay(1, check_all);
+        ok &= check("日志序号 = 队列序号 + 1，没有丢失",
+                    check_all.ordered && check_all.messages == JOURNAL_MESSAGES &&
+                    check_all.holes == 0 && journal_reader.lost_count() == 0 && !journal_reader.failed());
+    }
+
+    {
+        // 重新打开: 恢复写入位置；生产者挤出最旧消息，日志读取器漏读的部分写成空洞记录
+        Journal<uint64_t> journal(options);
+        ok &= check("重新打开后从最后一条记录之后继续", journal.next_sequence() == JOURNAL_MESSAGES + 1);
+
+        JournalQueue queue;
+        for (uint64_t i = 0; i < JOURNAL_MESSAGES; ++i) {
+            // 逐条写入再取走，把队列序号推进到与日志一致
+            queue.try_push(i);
+            queue.pop();
+        }
+        JournalReader<uint64_t, JOURNAL_QUEUE_CAPACITY> journal_reader(queue, journal);
+        journal_reader.start();
+        for (uint64_t i = JOURNAL_MESSAGES; i < 2 * JOURNAL_MESSAGES; ++i) {
+            queue.push_evict_oldest(i);
+        }
+        ok &= check("日志读取器追上队列",
+                    wait_until([&]() { return journal_reader.cursor().load() == 2 * JOURNAL_MESSAGES; }));
+        journal_reader.stop();
+
+        JournalCheck check_all;
+        journal.replay(1, check_all);
+        ok &= check("漏读写成空洞记录，序号对应关系保持",
+                    check_all.ordered && check_all.next == 2 * JOURNAL_MESSAGES + 1 &&
+                    check_all.messages + check_all.holes == 2 * JOURNAL_MESSAGES &&
+                    check_all.holes == journal_reader.lost_count() && !journal_reader.failed());
+        std::cout << "  (漏读 " << journal_reader.lost_count() << " 条)\n";
+    }
+
+    {
+        // 只按时间落盘: 最后一批记录写入后队列空闲，日志读取器仍在间隔到期后落盘
+        JournalOptions timed = options;
+        timed.sync_mode = JournalSyncMode::Msync;
+        timed.sync_every = 0;
+        timed.sync_interval_us = JOURNAL_SYNC_INTERVAL_US;
+        Journal<uint64_t> journal(timed);
+        const uint64_t first = journal.next_sequence();
+
+        JournalQueue queue;
+        for (uint64_t i = 0; i + 1 < first; ++i) {
+            queue.try_push(i);
+            queue.pop();
+        }
+        JournalReader<uint64_t, JOURNAL_QUEUE_CAPACITY> journal_reader(queue, journal);
+        journal_reader.start();
+        for (uint64_t i = 0; i < 3; ++i) {
+            queue.push(first - 1 + i);
+        }
+        const bool written = wait_until([&]() { return journal.next_sequence() == first + 3; });
+        const bool synced = wait_until([&]() { return journal.synced_sequence() == first + 3; });
+        ok &= check("空闲的日志在落盘间隔到期后落盘", written && synced && !journal_reader.failed());
+        journal_reader.stop();
+    }
+
+    remove_directory(directory);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// PipelineBuilder / Pipeline
+// ---------------------------------------------------------------------------
+
+constexpr size_t PIPELINE_CAPACITY = 64;
+constexpr int PIPELINE_MESSAGES = 10000;
+
+/**
+ * @brief 每条输入产生一条输出
+ */
+class DoubleStage : public PipelineStage<DoubleStage, int, int> {
+public:
+    int process(int&& value) {
+        return value * 2;
+    }
+};
+
+/**
+ * @brief 只保留4的倍数，其余过滤掉
+ */
+class MultipleOfFourStage : public PipelineStage<MultipleOfFourStage, int, int> {
+public:
+    std::optional<int> process(int&& value) {
+        if (value % 4 != 0) {
+            return std::nullopt;
+        }
+        return value;
+    }
+};
+
+/**
+ * @brief 终点阶段: 累加收到的消息，构造参数转发自 then()
+ */
+class SumStage : public PipelineStage<SumStage, int> {
+public:
+    explicit SumStage(std::atomic<long>* sum) : sum_(sum) {}
+
+    void process(int&& value) {
+        sum_->fetch_add(value, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<long>* sum_;
+};
+
+/**
+ * @brief 向流水线输入队列写入 0..PIPELINE_MESSAGES-1
+ */
+template<typename Queue>
+static void feed(Queue& input) {
+    for (int i = 0; i < PIPELINE_MESSAGES; ++i) {
+        while (!input.try_push(i)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static bool test_pipeline() {
+    std::cout << "Pipeline:\n";
+    bool ok = true;
+
+    {
+        // 以终点阶段结束: stop() 处理完所有已写入的消息才返回
+        std::atomic<long> sum{0};
+        auto pipeline = PipelineBuilder<int, PIPELINE_CAPACITY>()
+            .then<DoubleStage>("double")
+            .then<MultipleOfFourStage>("multiple_of_4")
+            .then<SumStage>("sum", &sum)
+            .build();
+        pipeline.start();
+        feed(pipeline.input());
+        pipeline.stop();
+
+        // 偶数 i 的 2i 通过过滤: 2 * (0 + 2 + ... + (N - 2))
+        const long half = PIPELINE_MESSAGES / 2;
+        const long expected = 2 * 2 * (half - 1) * half / 2;
+        const auto reports = pipeline.stage_reports();
+        ok &= check("stop() 后所有消息都已处理", sum.load() == expected);
+        ok &= check("各阶段统计",
+                    reports.size() == 3 &&
+                    reports[0].processed == PIPELINE_MESSAGES && reports[0].emitted == PIPELINE_MESSAGES &&
+                    reports[1].processed == PIPELINE_MESSAGES && reports[1].filtered == static_cast<uint64_t>(half) &&
+                    reports[2].processed == static_cast<uint64_t>(half) && reports[2].backlog == 0);
+        ok &= check("统计报告", pipeline.report().find("瓶颈阶段") != std::string::npos);
+    }
+
+    {
+        // 以有输出的阶段结束: 输出队列按顺序收到全部结果
+        auto pipeline = PipelineBuilder<int, PIPELINE_CAPACITY>()
+            .then<DoubleStage>("double")
+            .build();
+        pipeline.start();
+        std::thread producer([&]() { feed(pipeline.input()); });
+        bool ordered = true;
+        int expected = 0;
+        const bool received = wait_until([&]() {
+            while (auto value = pipeline.output().pop()) {
+                ordered &= *value == expected * 2;
+                expected++;
+            }
+            return expected == PIPELINE_MESSAGES;
+        });
+        producer.join();
+        pipeline.stop();
+        ok &= check("输出队列按序收到全部结果", received && ordered);
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// ReaderExecutor
+// ---------------------------------------------------------------------------
+
+constexpr size_t EXECUTOR_QUEUE_CAPACITY = 1024;  // 足够容纳全部消息，读取器不会漏读
+constexpr uint64_t EXECUTOR_MESSAGES = 1000;      // 每个队列写入的消息数
+constexpr size_t EXECUTOR_READERS_PER_QUEUE = 3;
+constexpr size_t EXECUTOR_THREADS = 2;
+constexpr size_t EXECUTOR_POLL_BUDGET = 4;        // 配额很小，读取器频繁轮换
+constexpr uint64_t EXECUTOR_LATE_MESSAGES = 16;   // 工作线程进入空闲休眠后再写入的消息数
+constexpr auto EXECUTOR_IDLE_WINDOW = std::chrono::milliseconds(200);  // 测量空闲CPU占用的时长
+
+using ExecutorQueue = NBQueue<uint64_t, EXECUTOR_QUEUE_CAPACITY>;
+
+/**
+ * @brief 校验收到的消息连续，可选依赖上游读取器: 处理时上游必须已处理过这条消息
+ */
+class CountingReader : public LockFreeQueueReader<CountingReader, uint64_t, EXECUTOR_QUEUE_CAPACITY> {
+    using Base = LockFreeQueueReader<CountingReader, uint64_t, EXECUTOR_QUEUE_CAPACITY>;
+    friend Base;
+
+    void on_data(const uint64_t& value) {
+        ordered &= value == received;
+        if (upstream_ != nullptr) {
+            ordered &= upstream_->cursor().load() > value;
+        }
+        received++;
+    }
+
+    const CountingReader* upstream_ = nullptr;
+
+public:
+    uint64_t received = 0;
+    bool ordered = true;
+
+    explicit CountingReader(ExecutorQueue& queue, const CountingReader* upstream = nullptr)
+        : Base(queue), upstream_(upstream) {
+        if (upstream_ != nullptr) {
+            depends_on(upstream_->cursor());
+        }
+    }
+};
+
+/**
+ * @brief 读取器是否空闲(没有在运行，也没有被执行器占用): 能添加到新的执行器即为空闲
+ */
+static bool reader_released(CountingReader& reader) {
+    try {
+        ReaderExecutor probe(1);
+        probe.add(reader);
+        return true;
+    } catch (const std::logic_error&) {
+        return false;
+    }
+}
+
+static bool test_reader_executor() {
+    std::cout << "ReaderExecutor:\n";
+    bool ok = true;
+
+    ExecutorQueue queues[2];
+    std::vector<std::unique_ptr<CountingReader>> readers;
+    for (auto& queue : queues) {
+        // 每个队列上是一条依赖链: 后一个读取器只处理前一个已处理完的消息
+        const CountingReader* upstream = nullptr;
+        for (size_t i = 0; i < EXECUTOR_READERS_PER_QUEUE; ++i) {
+            readers.push_back(std::make_unique<CountingReader>(queue, upstream));
+            upstream = readers.back().get();
+        }
+    }
+
+    {
+        // 添加后没有启动: 析构时把读取器交还，之后可以单独启动
+        ReaderExecutor unused(1);
+        unused.add(*readers[0]);
+    }
+    ok &= check("未启动的执行器析构后交还读取器", reader_released(*readers[0]));
+
+    ReaderExecutor executor(EXECUTOR_THREADS);
+    executor.set_poll_budget(EXECUTOR_POLL_BUDGET);
+    for (auto& reader : readers) {
+        executor.add(*reader);
+    }
+    bool rejected = false;
+    try {
+        executor.add(*readers[0]);
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    ok &= check("同一读取器不能重复添加", rejected);
+
+    executor.start();
+    ok &= check("工作线程数", executor.worker_count() == EXECUTOR_THREADS &&
+                               executor.reader_count() == readers.size());
+    for (uint64_t i = 0; i < EXECUTOR_MESSAGES; ++i) {
+        for (auto& queue : queues) {
+            while (!queue.try_push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    auto caught_up_to = [&](uint64_t total) {
+        return wait_until([&]() {
+            for (auto& reader : readers) {
+                if (reader->cursor().load() != total) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    };
+    const bool caught_up = caught_up_to(EXECUTOR_MESSAGES);
+
+    // 空闲一段时间后回退达到上限，工作线程休眠而不是一直自旋: 进程CPU占用远低于一个核
+    std::this_thread::sleep_for(EXECUTOR_IDLE_WINDOW / 4);
+    const std::clock_t cpu_begin = std::clock();
+    const auto wall_begin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(EXECUTOR_IDLE_WINDOW);
+    const double cpu_seconds = static_cast<double>(std::clock() - cpu_begin) / CLOCKS_PER_SEC;
+    const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_begin).count();
+    ok &= check("空闲的工作线程休眠让出CPU", cpu_seconds < wall_seconds / 2);
+
+    // 休眠中的工作线程仍能收到新消息
+    for (uint64_t i = EXECUTOR_MESSAGES; i < EXECUTOR_MESSAGES + EXECUTOR_LATE_MESSAGES; ++i) {
+        for (auto& queue : queues) {
+            queue.push(i);
+        }
+    }
+    const bool woke = caught_up_to(EXECUTOR_MESSAGES + EXECUTOR_LATE_MESSAGES);
+    executor.stop();
+
+    bool all_received = caught_up && woke;
+    for (auto& reader : readers) {
+        all_received &= reader->received == EXECUTOR_MESSAGES + EXECUTOR_LATE_MESSAGES && reader->ordered;
+    }
+    ok &= check("所有读取器按序收到全部消息，依赖链顺序正确", all_received);
+    ok &= check("停止后交还读取器", reader_released(*readers[0]));
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// 流量录制与回放
+// ---------------------------------------------------------------------------
+
+constexpr size_t CAPTURE_QUEUE_CAPACITY = 256;
+constexpr uint64_t CAPTURE_MESSAGES = 200;        // 录制的消息数，不超过队列容量，读取器不会漏读
+constexpr const char* CAPTURE_PATH = "component_test.cap";
+
+using CaptureQueue = NBQueue<uint64_t, CAPTURE_QUEUE_CAPACITY>;
+
+/**
+ * @brief 期望 load() 拒绝文件并抛出 std::runtime_error
+ */
+static bool capture_rejected(const char* path) {
+    try {
+        TrafficCapture<uint64_t>::load(path);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+static bool test_capture() {
+    std::cout << "CaptureReader / TrafficCapture:\n";
+    bool ok = true;
+
+    {
+        // 读取器录制队列中的消息，加载后按录制顺序生成
+        CaptureQueue queue;
+        CaptureWriter<uint64_t> writer(CAPTURE_PATH);
+        CaptureReader<uint64_t, CAPTURE_QUEUE_CAPACITY> reader(queue, writer);
+        reader.start();
+        for (uint64_t i = 0; i < CAPTURE_MESSAGES; ++i) {
+            queue.push(i * 3);
+        }
+        const bool recorded = wait_until([&]() { return reader.cursor().load() == CAPTURE_MESSAGES; });
+        reader.stop();
+        bool closed = true;
+        try {
+            writer.close();
+        } catch (const std::system_error&) {
+            closed = false;
+        }
+        ok &= check("录制全部消息", recorded && closed && !reader.failed() &&
+                                    writer.record_count() == CAPTURE_MESSAGES);
+
+        auto capture = TrafficCapture<uint64_t>::load(CAPTURE_PATH);
+        auto generate = capture.generator();
+        bool replayed = capture.size() == CAPTURE_MESSAGES;
+        for (uint64_t i = 0; i < CAPTURE_MESSAGES; ++i) {
+            replayed &= generate() == i * 3;
+        }
+        replayed &= generate() == 0;   // 到末尾后从头循环
+        ok &= check("回放内容与录制一致", replayed);
+    }
+
+    {
+        // 文件头中的记录数被改大: 与文件大小核对后拒绝，不按记录数预留内存
+        CaptureFileHeader header{};
+        std::FILE* file = std::fopen(CAPTURE_PATH, "r+b");
+        bool patched = file != nullptr && std::fread(&header, sizeof(header), 1, file) == 1;
+        header.record_count = UINT64_MAX / 2;
+        patched = patched && std::fseek(file, 0, SEEK_SET) == 0 &&
+                  std::fwrite(&header, sizeof(header), 1, file) == 1;
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+        ok &= check("记录数超过文件大小时拒绝加载", patched && capture_rejected(CAPTURE_PATH));
+    }
+
+    {
+        // 写入失败(磁盘已满)在 close() 中以 std::system_error 报告
+        bool reported = false;
+        try {
+            CaptureWriter<uint64_t> writer("/dev/full");
+            writer.write(0, 1);
+            writer.close();
+        } catch (const std::system_error&) {
+            reported = true;
+        }
+        ok &= check("写入失败时抛出 std::system_error", reported);
+    }
+
+    std::remove(CAPTURE_PATH);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// QueueNotifier
+// ---------------------------------------------------------------------------
+
+constexpr size_t NOTIFY_QUEUE_CAPACITY = 64;
+constexpr uint64_t NOTIFY_ROUNDS = 20;            // 消费者睡眠的次数
+constexpr uint64_t NOTIFY_BURST = 8;              // 每次睡眠期间写入的消息数
+constexpr int NOTIFY_EPOLL_TIMEOUT_MS = TIMEOUT_SEC * 1000;
+
+using NotifyQueue = NBQueue<uint64_t, NOTIFY_QUEUE_CAPACITY>;
+
+/**
+ * @brief 消费者在 epoll_wait 中等待通知通道，生产者每轮在消费者睡眠期间写入一批消息
+ *
+ * 生产者等消费者声明睡眠后才写入，消费者等生产者写完一批后才再次声明，
+ * 每次睡眠恰好对应一批消息: 醒来必须是因为通知通道可读，且一批消息只写一次 eventfd。
+ */
+static bool test_queue_notifier() {
+    std::cout << "QueueNotifier:\n";
+    bool ok = true;
+
+    NotifyQueue queue;
+    QueueNotifier notifier;
+    queue.set_notifier(&notifier);
+
+    const int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        throw std::system_error(errno, std::generic_category(), "epoll_create1");
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = notifier.fd();
+    if (::epoll_ctl(epfd, EPOLL_CTL_ADD, notifier.fd(), &event) != 0) {
+        ::close(epfd);
+        throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+    }
+
+    std::atomic<uint64_t> declared{0};    // 消费者已声明睡眠的轮数
+    std::atomic<uint64_t> pushed{0};      // 生产者已写完的轮数
+    uint64_t woken_by_notifier = 0;       // 因通知通道可读而醒来的次数
+    uint64_t notifications = 0;           // eventfd 计数之和，即写 eventfd 的次数
+    uint64_t received = 0;
+    bool ordered = true;
+
+    std::thread consumer([&]() {
+        for (uint64_t round = 0; round < NOTIFY_ROUNDS; ++round) {
+            if (!notifier.prepare_to_sleep(queue)) {
+                ordered = false;   // 上一批已取空，不应该有数据
+                continue;
+            }
+            declared.store(round + 1);
+            epoll_event ready{};
+            const int n = ::epoll_wait(epfd, &ready, 1, NOTIFY_EPOLL_TIMEOUT_MS);
+            notifier.wake();
+            if (n == 1 && ready.data.fd == notifier.fd()) {
+                woken_by_notifier++;
+                notifications += notifier.consume();
+            }
+            // 等这一批写完再取走，下一次声明睡眠时生产者已不再写入
+            wait_until([&]() { return pushed.load() > round; });
+            while (auto value = queue.pop()) {
+                ordered &= *value == received;
+                received++;
+            }
+        }
+    });
+
+    for (uint64_t round = 0; round < NOTIFY_ROUNDS; ++round) {
+        if (!wait_until([&]() { return declared.load() > round; })) {
+            break;
+        }
+        for (uint64_t i = 0; i < NOTIFY_BURST; ++i) {
+            queue.push(round * NOTIFY_BURST + i);
+        }
+        pushed.store(round + 1);
+    }
+    consumer.join();
+
+    ok &= check("睡眠中的消费者被生产者唤醒", woken_by_notifier == NOTIFY_ROUNDS);
+    ok &= check("同一次睡眠期间的写入合并为一次唤醒", notifications == NOTIFY_ROUNDS);
+    ok &= check("消费者按序收到全部消息", ordered && received == NOTIFY_ROUNDS * NOTIFY_BURST);
+
+    // 消费者没有声明睡眠时，写入不写 eventfd
+    for (uint64_t i = 0; i < NOTIFY_BURST; ++i) {
+        queue.push(i);
+    }
+    epoll_event ready{};
+    ok &= check("没有睡眠声明时不通知", ::epoll_wait(epfd, &ready, 1, 0) == 0);
+
+    ::close(epfd);
+    return ok;
+}
+
+int main() {
+    // 初始化高精度计时器
+    HighResolutionTimer::init();
+
+    bool ok = true;
+    ok &= test_routing_producer();
+    ok &= test_producer_held();
+    ok &= test_spill_restore();
+    ok &= test_journal();
+    ok &= test_pipeline();
+    ok &= test_reader_executor();
+    ok &= test_capture();
+    ok &= test_queue_notifier();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+#include "queue.hpp"
+#include "coroutine_queue.hpp"
+#include "thread_options.hpp"
+#include "latency_histogram.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+#include "timer.hpp"
+#include "test_data.hpp"
+
+/**
+ * @brief 协程扇出测试参数
+ */
+constexpr size_t FANOUT_QUEUE_CAPACITY = 256;       // 每个消费者队列的容量
+constexpr size_t DEFAULT_CONSUMERS = 256;           // 默认消费者(协程)数
+constexpr size_t DEFAULT_MESSAGES = 20000;          // 默认每个消费者处理的消息数
+
+using FanoutQueue = NBQueue<TestData, FANOUT_QUEUE_CAPACITY>;
+
+static inline void cpu_relax() {
+    #if defined(__x86_64__)
+        _mm_pause();
+    #elif defined(__aarch64__)
+        asm volatile("yield");
+    #endif
+}
+
+/**
+ * @brief 命令行参数
+ */
+struct Options {
+    size_t consumers = DEFAULT_CONSUMERS;
+    size_t messages = DEFAULT_MESSAGES;
+};
+
+static void print_usage(const char* prog) {
+    std::cout << "用法: " << prog << " [选项]\n"
+              << "  --consumers N     消费者协程数(默认 " << DEFAULT_CONSUMERS << ")\n"
+              << "  --messages N      每个消费者处理的消息数(默认 " << DEFAULT_MESSAGES << ")\n";
+}
+
+static bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--consumers" && has_value) {
+            options.consumers = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--messages" && has_value) {
+            options.messages = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.consumers > 0;
+}
+
+/**
+ * @brief 消费者协程: 从自己的队列取出消息，记录从写入到被处理的延迟
+ */
+static CoroutineTask consume(CoroutineScheduler& scheduler, FanoutQueue& queue,
+                             size_t messages, LatencyHistogram& histogram) {
+    for (size_t i = 0; i < messages; ++i) {
+        TestData data = co_await scheduler.pop(queue);
+        histogram.record(HighResolutionTimer::now() - data.timestamp);
+    }
+}
+
+/**
+ * @brief 一个生产者线程轮流向各队列写入，一个调度器线程上的协程各自消费一个队列
+ *
+ * 对比每个消费者独占一个线程的做法，协程消费者数可以远大于CPU核数。
+ */
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 初始化高精度计时器
+    HighResolutionTimer::init();
+
+    std::cout << "消费者协程数: " << options.consumers
+              << ", 每个消费者消息数: " << options.messages << "\n";
+
+    std::vector<std::unique_ptr<FanoutQueue>> queues;
+    for (size_t i = 0; i < options.consumers; ++i) {
+        queues.push_back(std::make_unique<FanoutQueue>());
+    }
+
+    LatencyHistogram histogram;
+    CoroutineScheduler scheduler;
+    for (auto& queue : queues) {
+        scheduler.spawn(consume(scheduler, *queue, options.messages, histogram));
+    }
+
+    const auto start = HighResolutionTimer::now();
+    std::thread producer([&queues, &options]() {
+        ThreadOptions thread_options;
+        thread_options.name = "producer";
+        apply_thread_options(thread_options);
+        for (size_t i = 0; i < options.messages; ++i) {
+            for (auto& queue : queues) {
+                TestData data(i);
+                data.timestamp = HighResolutionTimer::now();
+                while (!queue->try_push(data)) {
+                    cpu_relax();
+                }
+            }
+        }
+    });
+
+    ThreadOptions scheduler_options;
+    scheduler_options.name = "scheduler";
+    apply_thread_options(scheduler_options);
+    scheduler.run();
+    producer.join();
+    const auto end = HighResolutionTimer::now();
+
+    const double seconds = HighResolutionTimer::to_sec(end - start);
+    const double total = static_cast<double>(options.consumers) * options.messages;
+    std::cout << "总耗时: " << seconds * 1000 << " 毫秒, 吞吐量: " << total / seconds << " 条/秒\n";
+    std::cout << "\n=== 写入到被协程处理的延迟 ===\n" << histogram.get_stats();
+#if QUEUE_READER_PERF_STATS
+    std::cout << "\n" << scheduler.get_stats();
+#endif
+    return 0;
+}
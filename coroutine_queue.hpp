@@ -0,0 +1,453 @@
+#pragma once
+#if __cplusplus < 202002L
+#error "coroutine_queue.hpp 需要 C++20，请使用 -DENABLE_CXX20=ON 构建"
+#endif
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "timer.hpp"
+#include "backoff.hpp"
+#include "queue.hpp"
+
+class CoroutineScheduler;
+
+/**
+ * @brief 由 CoroutineScheduler 运行的协程任务
+ *
+ * 协程函数返回 CoroutineTask 即可，创建后处于挂起状态，交给 CoroutineScheduler::spawn() 运行，
+ * 之后由调度器负责销毁。任务只能被调度器运行，不能被其他协程 co_await。
+ */
+class CoroutineTask {
+public:
+    struct promise_type {
+        std::exception_ptr exception;   // 协程中未捕获的异常，由调度器重新抛出
+
+        CoroutineTask get_return_object() {
+            return CoroutineTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    CoroutineTask(CoroutineTask&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)) {}
+
+    CoroutineTask& operator=(CoroutineTask&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    CoroutineTask(const CoroutineTask&) = delete;
+    CoroutineTask& operator=(const CoroutineTask&) = delete;
+
+    /**
+     * @brief 析构函数，未交给调度器的任务直接销毁
+     */
+    ~CoroutineTask() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+private:
+    friend class CoroutineScheduler;
+
+    explicit CoroutineTask(std::coroutine_handle<promise_type> handle)
+        : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @brief 协程调度器性能统计
+ */
+#if QUEUE_READER_PERF_STATS
+class CoroutineSchedulerStats {
+public:
+    void record_resume() {
+        resumes++;
+    }
+
+    void record_suspend() {
+        suspends++;
+    }
+
+    void record_poll(size_t waiters) {
+        polls += waiters;
+    }
+
+    void record_idle() {
+        idle_rounds++;
+    }
+
+    std::string get_stats() const {
+        std::stringstream ss;
+        ss << "协程调度器统计:\n"
+           << "恢复次数: " << resumes.load() << "\n"
+           << "挂起次数: " << suspends.load() << "\n"
+           << "轮询次数: " << polls.load() << "\n"
+           << "空闲轮数: " << idle_rounds.load() << "\n";
+        return ss.str();
+    }
+
+    void reset() {
+        resumes = 0;
+        suspends = 0;
+        polls = 0;
+        idle_rounds = 0;
+    }
+
+private:
+    std::atomic<size_t> resumes{0};       // 恢复协程的次数
+    std::atomic<size_t> suspends{0};      // 协程因队列空/满挂起的次数
+    std::atomic<size_t> polls{0};         // 检查等待中协程的次数
+    std::atomic<size_t> idle_rounds{0};   // 没有任何协程可运行的轮数
+};
+#endif
+
+/**
+ * @brief 单线程协程调度器，让大量轻量消费者共享一个线程
+ *
+ * 协程通过 co_await scheduler.pop(queue) / push(queue, value) / read(queue, sequence)
+ * 访问 NBQueue，操作不能立即完成时挂起，调度器在每一轮中轮询等待中的操作，
+ * 有数据或有空间时直接替协程完成操作再恢复它，恢复后不会再被其他协程抢走。
+ *
+ * 队列本身不变，调度器所在线程之外的生产者和消费者照常使用普通接口。
+ * 调度器不是线程安全的，spawn() 和 run() 必须在同一线程调用，stop() 可以从任意线程调用。
+ *
+ * 用法:
+ *   CoroutineTask consume(CoroutineScheduler& s, NBQueue<TestData, 4096>& q) {
+ *       for (;;) {
+ *           TestData data = co_await s.pop(q);
+ *           ...
+ *       }
+ *   }
+ *   CoroutineScheduler scheduler;
+ *   for (auto* queue : queues) scheduler.spawn(consume(scheduler, *queue));
+ *   scheduler.run();
+ */
+class CoroutineScheduler {
+public:
+    static constexpr size_t MAX_IMMEDIATE = 64;   // 协程连续立即完成的操作数上限，超过后让出
+
+    /**
+     * @brief 等待中的操作
+     */
+    class Waiter {
+    public:
+        /**
+         * @brief 尝试完成操作，成功后调度器恢复协程
+         */
+        virtual bool try_complete() = 0;
+
+    protected:
+        ~Waiter() = default;
+
+    private:
+        friend class CoroutineScheduler;
+        std::coroutine_handle<> handle_;
+    };
+
+    CoroutineScheduler() = default;
+
+    ~CoroutineScheduler() {
+        for (auto handle : tasks_) {
+            handle.destroy();
+        }
+    }
+
+    CoroutineScheduler(const CoroutineScheduler&) = delete;
+    CoroutineScheduler& operator=(const CoroutineScheduler&) = delete;
+
+    /**
+     * @brief 添加任务，下一轮开始运行
+     */
+    void spawn(CoroutineTask task) {
+        auto handle = std::exchange(task.handle_, nullptr);
+        tasks_.push_back(handle);
+        ready_.push_back(handle);
+    }
+
+    /**
+     * @brief 运行直到所有任务结束或 stop() 被调用
+     * @throw 重新抛出任务中未捕获的异常，该任务已被销毁，其他任务保留，可以再次 run()
+     *
+     * 所有协程都在等待时按到达间隔自适应地回退(AdaptiveBackoff)，与读取器的等待策略相同。
+     */
+    void run() {
+        stop_requested_.store(false, std::memory_order_relaxed);
+        AdaptiveBackoff backoff;
+        while (!tasks_.empty() && !stop_requested_.load(std::memory_order_relaxed)) {
+            if (run_once()) {
+                backoff.on_progress();
+                continue;
+            }
+#if QUEUE_READER_PERF_STATS
+            stats_.record_idle();
+#endif
+            backoff.pause();
+        }
+    }
+
+    /**
+     * @brief 运行一轮: 恢复所有就绪的协程，再轮询一遍等待中的操作
+     * @return 有协程被恢复返回true
+     */
+    bool run_once() {
+        bool progress = false;
+        for (size_t i = 0, n = waiters_.size(); i < n;) {
+            if (waiters_[i]->try_complete()) {
+                ready_.push_back(waiters_[i]->handle_);
+                waiters_[i] = waiters_.back();
+                waiters_.pop_back();
+                n--;
+            } else {
+                i++;
+            }
+        }
+#if QUEUE_READER_PERF_STATS
+        stats_.record_poll(waiters_.size() + ready_.size());
+#endif
+
+        // 只运行本轮开始时就绪的协程，协程中让出的会在下一轮运行
+        for (size_t count = ready_.size(); count > 0; --count) {
+            auto handle = ready_.front();
+            ready_.pop_front();
+            resume(handle);
+            progress = true;
+        }
+        return progress;
+    }
+
+    /**
+     * @brief 请求 run() 在当前一轮结束后返回，可以从任意线程调用
+     */
+    void stop() {
+        stop_requested_.store(true, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 尚未结束的任务数
+     */
+    size_t task_count() const {
+        return tasks_.size();
+    }
+
+    /**
+     * @brief 从队列弹出一条消息，队列为空时挂起
+     * @return 可等待对象，co_await 的结果为弹出的 T
+     */
+    template<typename T, size_t Capacity>
+    auto pop(NBQueue<T, Capacity>& queue);
+
+    /**
+     * @brief 向队列写入一条消息，队列满时挂起
+     * @return 可等待对象，co_await 返回时消息已写入
+     */
+    template<typename T, size_t Capacity>
+    auto push(NBQueue<T, Capacity>& queue, T value);
+
+    /**
+     * @brief 按序号读取消息(不移除)，尚未写入时挂起
+     * @return 可等待对象，co_await 的结果为 std::optional<T>，消息已被移除时为 nullopt
+     */
+    template<typename T, size_t Capacity>
+    auto read(NBQueue<T, Capacity>& queue, uint64_t sequence);
+
+    /**
+     * @brief 让出执行权，下一轮再继续
+     */
+    auto yield() {
+        struct YieldAwaiter {
+            CoroutineScheduler& scheduler;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { scheduler.ready_.push_back(handle); }
+            void await_resume() const noexcept {}
+        };
+        return YieldAwaiter{*this};
+    }
+
+#if QUEUE_READER_PERF_STATS
+    std::string get_stats() const {
+        return stats_.get_stats();
+    }
+
+    void reset_stats() {
+        stats_.reset();
+    }
+#endif
+
+private:
+    template<typename Derived>
+    friend class QueueAwaiter;
+
+    std::vector<std::coroutine_handle<CoroutineTask::promise_type>> tasks_;   // 所有未结束的任务
+    std::deque<std::coroutine_handle<>> ready_;         // 可以运行的协程
+    std::vector<Waiter*> waiters_;                      // 等待中的操作，位于各协程帧中
+    size_t immediate_ = 0;                              // 当前协程连续立即完成的操作数
+    std::atomic<bool> stop_requested_{false};
+
+#if QUEUE_READER_PERF_STATS
+    CoroutineSchedulerStats stats_;
+#endif
+
+    /**
+     * @brief 当前协程的操作能否立即完成而不让出
+     */
+    bool try_immediate() {
+        return ++immediate_ <= MAX_IMMEDIATE;
+    }
+
+    void wait(Waiter* waiter, std::coroutine_handle<> handle) {
+        waiter->handle_ = handle;
+        waiters_.push_back(waiter);
+#if QUEUE_READER_PERF_STATS
+        stats_.record_suspend();
+#endif
+    }
+
+    void resume(std::coroutine_handle<> handle) {
+        immediate_ = 0;
+#if QUEUE_READER_PERF_STATS
+        stats_.record_resume();
+#endif
+        handle.resume();
+        if (!handle.done()) {
+            return;
+        }
+        // 任务结束: 只有顶层任务会运行到终点
+        auto task = std::coroutine_handle<CoroutineTask::promise_type>::from_address(handle.address());
+        for (size_t i = 0; i < tasks_.size(); ++i) {
+            if (tasks_[i] == task) {
+                tasks_[i] = tasks_.back();
+                tasks_.pop_back();
+                break;
+            }
+        }
+        std::exception_ptr exception = task.promise().exception;
+        task.destroy();
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+/**
+ * @brief 队列操作的可等待对象基类，使用CRTP模式
+ *
+ * 派生类实现 bool attempt()，尝试完成操作并保存结果。能立即完成时不挂起；
+ * 否则把自己登记到调度器，由调度器轮询 attempt()，完成后恢复协程。
+ */
+template<typename Derived>
+class QueueAwaiter : public CoroutineScheduler::Waiter {
+public:
+    explicit QueueAwaiter(CoroutineScheduler& scheduler)
+        : scheduler_(scheduler) {}
+
+    bool await_ready() {
+        return scheduler_.try_immediate() && self().attempt();
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        scheduler_.wait(this, handle);
+    }
+
+    bool try_complete() override {
+        return self().attempt();
+    }
+
+private:
+    CoroutineScheduler& scheduler_;
+
+    Derived& self() {
+        return static_cast<Derived&>(*this);
+    }
+};
+
+template<typename T, size_t Capacity>
+class PopAwaiter : public QueueAwaiter<PopAwaiter<T, Capacity>> {
+public:
+    PopAwaiter(CoroutineScheduler& scheduler, NBQueue<T, Capacity>& queue)
+        : QueueAwaiter<PopAwaiter>(scheduler), queue_(queue) {}
+
+    bool attempt() {
+        result_ = queue_.pop();
+        return result_.has_value();
+    }
+
+    T await_resume() {
+        return std::move(*result_);
+    }
+
+private:
+    NBQueue<T, Capacity>& queue_;
+    std::optional<T> result_;
+};
+
+template<typename T, size_t Capacity>
+class PushAwaiter : public QueueAwaiter<PushAwaiter<T, Capacity>> {
+public:
+    PushAwaiter(CoroutineScheduler& scheduler, NBQueue<T, Capacity>& queue, T value)
+        : QueueAwaiter<PushAwaiter>(scheduler), queue_(queue), value_(std::move(value)) {}
+
+    bool attempt() {
+        return queue_.try_push(value_);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    NBQueue<T, Capacity>& queue_;
+    T value_;   // 写入成功前保留在可等待对象中
+};
+
+template<typename T, size_t Capacity>
+class ReadAwaiter : public QueueAwaiter<ReadAwaiter<T, Capacity>> {
+public:
+    ReadAwaiter(CoroutineScheduler& scheduler, NBQueue<T, Capacity>& queue, uint64_t sequence)
+        : QueueAwaiter<ReadAwaiter>(scheduler), queue_(queue), sequence_(sequence) {}
+
+    bool attempt() {
+        result_ = queue_.read_sequence(sequence_);
+        // 读不到且序号已落在队首之前，说明消息已被移除，不会再出现
+        return result_.has_value() || sequence_ < queue_.head_sequence();
+    }
+
+    std::optional<T> await_resume() {
+        return std::move(result_);
+    }
+
+private:
+    NBQueue<T, Capacity>& queue_;
+    uint64_t sequence_;
+    std::optional<T> result_;
+};
+
+template<typename T, size_t Capacity>
+auto CoroutineScheduler::pop(NBQueue<T, Capacity>& queue) {
+    return PopAwaiter<T, Capacity>(*this, queue);
+}
+
+template<typename T, size_t Capacity>
+auto CoroutineScheduler::push(NBQueue<T, Capacity>& queue, T value) {
+    return PushAwaiter<T, Capacity>(*this, queue, std::move(value));
+}
+
+template<typename T, size_t Capacity>
+auto CoroutineScheduler::read(NBQueue<T, Capacity>& queue, uint64_t sequence) {
+    return ReadAwaiter<T, Capacity>(*this, queue, sequence);
+}
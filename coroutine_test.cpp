@@ -0,0 +1,151 @@
+#include "queue.hpp"
+#include "coroutine_queue.hpp"
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include "timer.hpp"
+
+/**
+ * @brief 协程接口测试: CoroutineScheduler 上的 pop、带背压的 push、读取已移除的序号和异常传播
+ */
+constexpr size_t CORO_QUEUE_CAPACITY = 8;         // 可容纳 7 条，很快写满
+constexpr uint64_t CORO_MESSAGES = 100;           // 每个场景传递的消息数
+
+using CoroQueue = NBQueue<uint64_t, CORO_QUEUE_CAPACITY>;
+
+/**
+ * @brief 打印一项检查的结果
+ */
+static bool check(const char* name, bool ok) {
+    std::cout << "  " << name << (ok ? " 通过" : " 失败") << "\n";
+    return ok;
+}
+
+static CoroutineTask produce(CoroutineScheduler& scheduler, CoroQueue& queue, uint64_t count) {
+    for (uint64_t i = 0; i < count; ++i) {
+        co_await scheduler.push(queue, i);
+    }
+}
+
+static CoroutineTask consume(CoroutineScheduler& scheduler, CoroQueue& queue, uint64_t count,
+                             std::vector<uint64_t>& received, bool& saw_full) {
+    // 生产者先运行，写满队列后挂起，消费者第一次运行时队列是满的
+    saw_full = queue.tail_sequence() - queue.head_sequence() == CORO_QUEUE_CAPACITY - 1;
+    for (uint64_t i = 0; i < count; ++i) {
+        received.push_back(co_await scheduler.pop(queue));
+    }
+}
+
+/**
+ * @brief 生产者与消费者协程共享一个调度器: 队列满时 push 挂起，空时 pop 挂起
+ */
+static bool test_pop_and_push() {
+    std::cout << "pop / push:\n";
+    bool ok = true;
+
+    CoroQueue queue;
+    CoroutineScheduler scheduler;
+    std::vector<uint64_t> received;
+    bool saw_full = false;
+    scheduler.spawn(produce(scheduler, queue, CORO_MESSAGES));
+    scheduler.spawn(consume(scheduler, queue, CORO_MESSAGES, received, saw_full));
+    scheduler.run();
+
+    bool ordered = received.size() == CORO_MESSAGES;
+    for (uint64_t i = 0; ordered && i < CORO_MESSAGES; ++i) {
+        ordered = received[i] == i;
+    }
+    ok &= check("队列满时生产者挂起等待消费者", saw_full);
+    ok &= check("消费者按序收到全部消息", ordered);
+    ok &= check("所有任务结束后 run() 返回", scheduler.task_count() == 0 && queue.pop() == std::nullopt);
+    return ok;
+}
+
+static CoroutineTask read_sequences(CoroutineScheduler& scheduler, CoroQueue& queue,
+                                    std::vector<std::optional<uint64_t>>& results,
+                                    std::vector<uint64_t> sequences) {
+    for (uint64_t sequence : sequences) {
+        results.push_back(co_await scheduler.read(queue, sequence));
+    }
+}
+
+static CoroutineTask publish_later(CoroutineScheduler& scheduler, CoroQueue& queue, uint64_t value) {
+    // 让读取者先挂起在尚未写入的序号上
+    co_await scheduler.yield();
+    co_await scheduler.yield();
+    queue.push_evict_oldest(value);
+}
+
+/**
+ * @brief read: 已被挤出的序号返回 nullopt，仍在的序号返回消息，尚未写入的序号挂起到写入
+ */
+static bool test_read() {
+    std::cout << "read:\n";
+    bool ok = true;
+
+    CoroQueue queue;
+    for (uint64_t i = 0; i < 2 * CORO_QUEUE_CAPACITY; ++i) {
+        queue.push_evict_oldest(i * 10);
+    }
+    const uint64_t head = queue.head_sequence();
+    const uint64_t tail = queue.tail_sequence();
+
+    CoroutineScheduler scheduler;
+    std::vector<std::optional<uint64_t>> results;
+    scheduler.spawn(read_sequences(scheduler, queue, results, {0, head, tail}));
+    scheduler.spawn(publish_later(scheduler, queue, tail * 10));
+    scheduler.run();
+
+    ok &= check("读取已被挤出的序号得到 nullopt", results.size() == 3 && results[0] == std::nullopt);
+    ok &= check("读取仍在队列中的序号", results.size() == 3 && results[1] == head * 10);
+    ok &= check("读取尚未写入的序号时挂起到写入", results.size() == 3 && results[2] == tail * 10);
+    return ok;
+}
+
+static CoroutineTask fail_after_yield(CoroutineScheduler& scheduler) {
+    co_await scheduler.yield();
+    throw std::runtime_error("任务失败");
+}
+
+/**
+ * @brief 任务中未捕获的异常从 run() 抛出，失败的任务被销毁，其他任务保留并可继续运行
+ */
+static bool test_exception() {
+    std::cout << "异常传播:\n";
+    bool ok = true;
+
+    CoroQueue queue;
+    CoroutineScheduler scheduler;
+    std::vector<uint64_t> received;
+    bool saw_full = false;
+    scheduler.spawn(fail_after_yield(scheduler));
+    scheduler.spawn(consume(scheduler, queue, 1, received, saw_full));
+
+    bool thrown = false;
+    try {
+        scheduler.run();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    ok &= check("run() 重新抛出任务中的异常", thrown);
+    ok &= check("失败的任务被销毁，其他任务保留", scheduler.task_count() == 1);
+
+    queue.push(42);
+    scheduler.run();
+    ok &= check("再次 run() 完成剩余任务",
+                scheduler.task_count() == 0 && received.size() == 1 && received[0] == 42);
+    return ok;
+}
+
+int main() {
+    // 初始化高精度计时器
+    HighResolutionTimer::init();
+
+    bool ok = true;
+    ok &= test_pop_and_push();
+    ok &= test_read();
+    ok &= test_exception();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+/**
+ * @brief CPU拓扑信息
+ *
+ * 从 /sys/devices/system/cpu 读取每个在线逻辑CPU所属的物理核、物理封装(socket)和NUMA节点，
+ * 用于挑选"同核超线程"、"同socket不同核"、"跨socket"的CPU组合。
+ * 读取失败的字段记为-1。
+ */
+class CpuTopology {
+public:
+    /**
+     * @brief 单个逻辑CPU的信息
+     */
+    struct Cpu {
+        int id;        // 逻辑CPU编号
+        int core;      // 物理核编号(同一socket内唯一)
+        int socket;    // 物理封装编号
+        int node;      // NUMA节点编号
+    };
+
+    /**
+     * @brief 线程放置方式
+     */
+    enum class Placement {
+        SameCoreHT,    // 同一物理核的两个超线程
+        SameSocket,    // 同一socket的两个不同物理核
+        CrossSocket,   // 两个不同socket
+    };
+
+    CpuTopology() {
+        const long count = sysconf(_SC_NPROCESSORS_CONF);
+        for (int id = 0; id < count; ++id) {
+            const std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+            if (read_int(base + "/online").value_or(1) == 0) {
+                continue;
+            }
+            cpus_.push_back(Cpu{
+                id,
+                read_int(base + "/topology/core_id").value_or(-1),
+                read_int(base + "/topology/physical_package_id").value_or(-1),
+                read_node(base)});
+        }
+    }
+
+    const std::vector<Cpu>& cpus() const { return cpus_; }
+
+    /**
+     * @brief 查询逻辑CPU所属的NUMA节点
+     * @param cpu 逻辑CPU编号
+     * @return NUMA节点编号，未知时返回-1
+     */
+    int node_of(int cpu) const {
+        for (const auto& c : cpus_) {
+            if (c.id == cpu) {
+                return c.node;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief 查找满足放置方式的一对CPU
+     * @param placement 放置方式
+     * @return 一对逻辑CPU编号，没有满足条件的组合则返回nullopt
+     */
+    std::optional<std::pair<int, int>> find_pair(Placement placement) const {
+        for (size_t i = 0; i < cpus_.size(); ++i) {
+            for (size_t j = i + 1; j < cpus_.size(); ++j) {
+                const Cpu& a = cpus_[i];
+                const Cpu& b = cpus_[j];
+                if (a.core < 0 || a.socket < 0 || b.core < 0 || b.socket < 0) {
+                    continue;
+                }
+                const bool same_socket = a.socket == b.socket;
+                const bool same_core = same_socket && a.core == b.core;
+                switch (placement) {
+                    case Placement::SameCoreHT:
+                        if (same_core) return std::make_pair(a.id, b.id);
+                        break;
+                    case Placement::SameSocket:
+                        if (same_socket && !same_core) return std::make_pair(a.id, b.id);
+                        break;
+                    case Placement::CrossSocket:
+                        if (!same_socket) return std::make_pair(a.id, b.id);
+                        break;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief 将放置方式解析为枚举值
+     * @param name "same-core-ht" / "same-socket" / "cross-socket"
+     */
+    static std::optional<Placement> parse_placement(const std::string& name) {
+        if (name == "same-core-ht") return Placement::SameCoreHT;
+        if (name == "same-socket") return Placement::SameSocket;
+        if (name == "cross-socket") return Placement::CrossSocket;
+        return std::nullopt;
+    }
+
+private:
+    std::vector<Cpu> cpus_;
+
+    static std::optional<int> read_int(const std::string& path) {
+        std::ifstream in(path);
+        int value;
+        if (in >> value) {
+            return value;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief 从CPU目录下的 nodeN 链接读取NUMA节点编号
+     */
+    static int read_node(const std::string& cpu_dir) {
+        DIR* dir = opendir(cpu_dir.c_str());
+        if (!dir) {
+            return -1;
+        }
+        int node = -1;
+        while (dirent* entry = readdir(dir)) {
+            if (std::strncmp(entry->d_name, "node", 4) == 0 &&
+                std::isdigit(static_cast<unsigned char>(entry->d_name[4]))) {
+                node = std::atoi(entry->d_name + 4);
+                break;
+            }
+        }
+        closedir(dir);
+        return node;
+    }
+};
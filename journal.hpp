@@ -0,0 +1,813 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "timer.hpp"
+#include "lock_free_queue_reader.hpp"
+
+/**
+ * @brief 日志段文件头，位于每个段文件开头，独占第一页
+ *
+ * 段文件格式(小端，定长记录):
+ * - [0, 页大小): 段文件头
+ * - 之后依次是记录，每条记录为 JournalRecordHeader + T 的原始字节，按8字节对齐
+ * 段文件创建时一次性扩展到固定大小，未写入部分全为0；
+ * 恢复时从头扫描，遇到序号不连续或校验和不符的记录即视为日志末尾。
+ * 空洞记录(JOURNAL_RECORD_HOLE)只占用序号，消息部分全为0，表示这条消息没有被记录下来。
+ */
+struct JournalSegmentHeader {
+    static constexpr char MAGIC[8] = {'N', 'B', 'Q', 'J', 'R', 'N', 'L', '1'};
+
+    char magic[8];            // 魔数
+    uint32_t record_size;     // 单条记录字节数(含记录头和对齐)
+    uint32_t payload_size;    // 消息字节数，即 sizeof(T)
+    uint64_t first_sequence;  // 本段第一条记录的序号
+    uint64_t capacity;        // 本段可容纳的记录数
+};
+
+/**
+ * @brief 日志记录头
+ */
+struct JournalRecordHeader {
+    uint64_t sequence;   // 记录序号，从1开始连续递增
+    uint32_t checksum;   // 序号和消息内容的FNV-1a校验和
+    uint32_t flags;      // 记录标志，见 JOURNAL_RECORD_HOLE
+};
+
+constexpr uint32_t JOURNAL_RECORD_HOLE = 1;   // 空洞记录: 占住序号，但消息已丢失
+
+/**
+ * @brief 日志落盘方式
+ */
+enum class JournalSyncMode {
+    None,        // 不主动落盘，由内核页缓存写回(进程崩溃不丢，机器掉电可能丢)
+    Msync,       // msync(MS_SYNC) 同步当前段中未落盘的范围
+    Fdatasync,   // fdatasync 同步当前段文件
+};
+
+/**
+ * @brief 日志配置
+ */
+struct JournalOptions {
+    std::string directory;                           // 日志目录，不存在时自动创建
+    size_t segment_size = 64 * 1024 * 1024;          // 每个段文件的大小(字节)
+    JournalSyncMode sync_mode = JournalSyncMode::Msync;
+    size_t sync_every = 1024;                        // 每写入多少条记录落盘一次，0表示不按条数
+    uint64_t sync_interval_us = 10000;               // 距上次落盘超过该时间后落盘(下一次写入或 JournalReader 空闲时)，0表示不按时间
+};
+
+/**
+ * @brief 日志性能统计
+ */
+#if QUEUE_PERF_STATS
+class JournalStats {
+public:
+    void record_append() {
+        appended++;
+    }
+
+    void record_holes(uint64_t count) {
+        holes += count;
+    }
+
+    void record_sync(uint64_t start_time) {
+        const auto duration = HighResolutionTimer::now() - start_time;
+        syncs++;
+        sync_total_ticks += duration;
+        if (duration > sync_max_ticks) {
+            sync_max_ticks = duration;
+        }
+    }
+
+    void record_segment_rolled() {
+        segments_rolled++;
+    }
+
+    std::string get_stats() const {
+        std::stringstream ss;
+        ss << "日志统计:\n";
+        ss << "写入记录数: " << appended << "\n";
+        ss << "空洞记录数: " << holes << "\n";
+        ss << "落盘次数: " << syncs << "\n";
+        if (syncs > 0) {
+            ss << "平均落盘耗时: " << HighResolutionTimer::to_us(sync_total_ticks / syncs) << " us\n";
+            ss << "最大落盘耗时: " << HighResolutionTimer::to_us(sync_max_ticks) << " us\n";
+        }
+        ss << "切换段文件次数: " << segments_rolled << "\n";
+        return ss.str();
+    }
+
+    void reset() {
+        appended = 0;
+        holes = 0;
+        syncs = 0;
+        sync_total_ticks = 0;
+        sync_max_ticks = 0;
+        segments_rolled = 0;
+    }
+
+private:
+    // 日志只由一个线程写入，统计不需要原子变量
+    size_t appended = 0;            // 写入记录数
+    uint64_t holes = 0;             // 空洞记录数
+    size_t syncs = 0;               // 落盘次数
+    uint64_t sync_total_ticks = 0;  // 落盘总耗时
+    uint64_t sync_max_ticks = 0;    // 落盘最大耗时
+    size_t segments_rolled = 0;     // 切换段文件次数
+};
+#endif
+
+/**
+ * @brief 基于内存映射的分段只追加日志
+ * @tparam T 消息类型，必须可平凡复制，按原始字节写入
+ *
+ * 每条消息分配一个连续递增的序号，写入当前段文件的映射中；段写满后切换到新段，
+ * 段文件名为 journal-<首条序号>.seg。落盘按 JournalOptions 中的条数/时间间隔批量进行，
+ * 两次落盘之间的记录在进程崩溃时不会丢失(已在页缓存中)，机器掉电时可能丢失。
+ *
+ * 打开已有目录时会扫描最后一个段，找到最后一条有效记录后继续追加。
+ * replay() 按序号重放历史记录，save_position()/load_positions() 保存和恢复各消费者的进度，
+ * 重启后消费者从 load_positions() 得到的序号开始 replay 即可追上崩溃前的状态。
+ *
+ * 写入不是线程安全的，应由单个线程(通常是 JournalReader)独占，不放在生产者的关键路径上。
+ * replay() 和 next_sequence() 可以在其他线程上与写入并发调用。
+ */
+template<typename T>
+class Journal {
+    static_assert(std::is_trivially_copyable_v<T>, "日志按原始字节保存消息，T 必须可平凡复制");
+
+public:
+    /**
+     * @brief 打开或创建日志
+     * @param options 日志配置
+     * @throw std::system_error 创建目录、打开或映射文件失败
+     * @throw std::runtime_error 已有段文件的格式与 T 不匹配
+     */
+    explicit Journal(JournalOptions options)
+        : options_(std::move(options)) {
+        page_size_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        data_offset_ = (sizeof(JournalSegmentHeader) + page_size_ - 1) / page_size_ * page_size_;
+        segment_capacity_ = std::max<size_t>(
+            1, (std::max(options_.segment_size, data_offset_ + RECORD_SIZE) - data_offset_) / RECORD_SIZE);
+
+        if (::mkdir(options_.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::system_error(errno, std::generic_category(), "mkdir " + options_.directory);
+        }
+        recover();
+        last_sync_ticks_ = HighResolutionTimer::now();
+    }
+
+    /**
+     * @brief 析构函数，落盘并关闭当前段
+     *
+     * 析构时落盘失败无法上报，需要确认落盘结果时先显式调用 sync()。
+     */
+    ~Journal() {
+        if (segment_.base != nullptr) {
+            try {
+                sync();
+            } catch (const std::system_error&) {
+            }
+        }
+        close_segment(segment_);
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    /**
+     * @brief 追加一条消息
+     * @return 分配给该消息的序号
+     * @throw std::system_error 切换段文件或落盘失败；落盘失败时记录已写入、序号已分配
+     */
+    uint64_t append(const T& value) {
+        const uint64_t sequence = write_record(&value);
+#if QUEUE_PERF_STATS
+        stats_.record_append();
+#endif
+        maybe_sync();
+        return sequence;
+    }
+
+    /**
+     * @brief 追加 count 条空洞记录，占住这些序号但不保存消息
+     * @return 第一条空洞记录的序号
+     * @throw std::system_error 切换段文件或落盘失败
+     *
+     * 消息在写入日志之前就已丢失时(例如 JournalReader 漏读)，用空洞记录让后续消息的序号保持不变，
+     * replay() 不会把空洞记录当作消息交给回调(见 replay)。
+     */
+    uint64_t append_holes(uint64_t count) {
+        const uint64_t first = next_sequence_.load(std::memory_order_relaxed);
+        for (uint64_t i = 0; i < count; ++i) {
+            write_record(nullptr);
+        }
+#if QUEUE_PERF_STATS
+        stats_.record_holes(count);
+#endif
+        maybe_sync();
+        return first;
+    }
+
+    /**
+     * @brief 把上次落盘之后写入的记录落盘
+     * @throw std::system_error msync 或 fdatasync 失败，失败的范围保持未落盘状态
+     */
+    void sync() {
+        if (unsynced_ == 0 || segment_.base == nullptr) {
+            last_sync_ticks_ = HighResolutionTimer::now();
+            return;
+        }
+#if QUEUE_PERF_STATS
+        const auto start_time = HighResolutionTimer::now();
+#endif
+        switch (options_.sync_mode) {
+            case JournalSyncMode::None:
+                break;
+            case JournalSyncMode::Msync: {
+                // 只同步未落盘的记录所在的页
+                const size_t begin = (data_offset_ + segment_.synced * RECORD_SIZE) / page_size_ * page_size_;
+                const size_t end = data_offset_ + segment_.count * RECORD_SIZE;
+                if (::msync(segment_.base + begin, end - begin, MS_SYNC) != 0) {
+                    throw std::system_error(errno, std::generic_category(), "msync");
+                }
+                break;
+            }
+            case JournalSyncMode::Fdatasync:
+                if (::fdatasync(segment_.fd) != 0) {
+                    throw std::system_error(errno, std::generic_category(), "fdatasync");
+                }
+                break;
+        }
+        segment_.synced = segment_.count;
+        unsynced_ = 0;
+        synced_sequence_.store(next_sequence_.load(std::memory_order_relaxed), std::memory_order_release);
+        last_sync_ticks_ = HighResolutionTimer::now();
+#if QUEUE_PERF_STATS
+        stats_.record_sync(start_time);
+#endif
+    }
+
+    /**
+     * @brief 下一条消息将获得的序号，也就是已写入的记录数 + 1
+     */
+    uint64_t next_sequence() const {
+        return next_sequence_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 已落盘的记录之后的第一个序号，此前的记录都已按 sync_mode 落盘
+     *
+     * 可在写入线程之外调用，打开日志时已有的记录视为已落盘。
+     */
+    uint64_t synced_sequence() const {
+        return synced_sequence_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 达到落盘条数或时间间隔时落盘
+     * @throw std::system_error 落盘失败
+     *
+     * 写入时自动调用；写入线程空闲时也应定期调用，否则最后一批记录要等到下一次写入才落盘
+     * (JournalReader 在队列为空时调用)。
+     */
+    void maybe_sync() {
+        if ((options_.sync_every > 0 && unsynced_ >= options_.sync_every) ||
+            (options_.sync_interval_us > 0 &&
+             HighResolutionTimer::to_us(HighResolutionTimer::now() - last_sync_ticks_) >=
+                 static_cast<double>(options_.sync_interval_us))) {
+            sync();
+        }
+    }
+
+    /**
+     * @brief 从指定序号开始重放日志
+     * @param from_sequence 起始序号(含)，小于最早记录时从最早记录开始
+     * @param handler 回调，签名为 void(uint64_t 序号, const T& 消息)
+     * @return 重放的记录数，不含空洞记录
+     * @throw std::system_error 打开或映射段文件失败
+     *
+     * 只读取已写入的记录，可在写入线程之外调用，但不会看到调用之后追加的记录。
+     * 空洞记录不会交给 handler；如果 handler 还可以按 void(uint64_t 序号, std::nullptr_t) 调用，
+     * 则每条空洞记录以 nullptr 调用一次，调用方可以据此发现缺失的消息。
+     */
+    template<typename Handler>
+    size_t replay(uint64_t from_sequence, Handler&& handler) const {
+        return replay(from_sequence, next_sequence_.load(std::memory_order_acquire),
+                      std::forward<Handler>(handler));
+    }
+
+    /**
+     * @brief 重放 [from_sequence, to_sequence) 范围内的记录
+     * @param to_sequence 结束序号(不含)，超过已写入的记录时只重放到最后一条
+     *
+     * 用于读取器漏读后补齐缺失的一段，见 LockFreeQueueReader 的 on_gap。
+     */
+    template<typename Handler>
+    size_t replay(uint64_t from_sequence, uint64_t to_sequence, Handler&& handler) const {
+        size_t replayed = 0;
+        // 先确定结束序号再列出段文件: 之后新建的段都从结束序号之后开始，不会读到写了一半的段
+        const uint64_t written = next_sequence_.load(std::memory_order_acquire);
+        const uint64_t end_sequence = to_sequence < written ? to_sequence : written;
+        for (const auto& segment : list_segments()) {
+            if (segment.first_sequence + segment_capacity_ <= from_sequence) {
+                continue;
+            }
+            if (segment.first_sequence >= end_sequence) {
+                break;
+            }
+            MappedSegment mapped = map_segment(segment.path, O_RDONLY, PROT_READ);
+            for (uint64_t index = from_sequence > segment.first_sequence
+                                      ? from_sequence - segment.first_sequence : 0;
+                 index < segment_capacity_; ++index) {
+                T value;
+                bool hole = false;
+                const uint64_t sequence = segment.first_sequence + index;
+                if (sequence >= end_sequence || !read_record(mapped, index, sequence, value, hole)) {
+                    break;
+                }
+                if (hole) {
+                    if constexpr (std::is_invocable_v<Handler&, uint64_t, std::nullptr_t>) {
+                        handler(sequence, nullptr);
+                    }
+                    continue;
+                }
+                handler(sequence, static_cast<const T&>(value));
+                replayed++;
+            }
+            close_segment(mapped);
+        }
+        return replayed;
+    }
+
+    /**
+     * @brief 保存消费者进度
+     * @param consumer 消费者名称，用作文件名
+     * @param next_sequence 该消费者下一条要处理的序号
+     * @throw std::system_error 写入失败
+     *
+     * 先写临时文件再重命名，崩溃时要么是旧值要么是新值。
+     */
+    void save_position(const std::string& consumer, uint64_t next_sequence) const {
+        const std::string path = options_.directory + "/" + consumer + POSITION_SUFFIX;
+        const std::string tmp_path = path + ".tmp";
+        const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + tmp_path);
+        }
+        const uint64_t record[2] = {next_sequence, ~next_sequence};
+        if (::write(fd, record, sizeof(record)) != static_cast<ssize_t>(sizeof(record)) ||
+            ::fdatasync(fd) != 0) {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "write " + tmp_path);
+        }
+        ::close(fd);
+        if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            throw std::system_error(errno, std::generic_category(), "rename " + path);
+        }
+    }
+
+    /**
+     * @brief 读取所有消费者保存的进度
+     * @return 消费者名称 -> 下一条要处理的序号，损坏的进度文件会被忽略
+     */
+    std::map<std::string, uint64_t> load_positions() const {
+        std::map<std::string, uint64_t> positions;
+        DIR* dir = ::opendir(options_.directory.c_str());
+        if (!dir) {
+            return positions;
+        }
+        const size_t suffix_len = std::strlen(POSITION_SUFFIX);
+        while (dirent* entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.size() <= suffix_len ||
+                name.compare(name.size() - suffix_len, suffix_len, POSITION_SUFFIX) != 0) {
+                continue;
+            }
+            const std::string path = options_.directory + "/" + name;
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            uint64_t record[2] = {};
+            if (::read(fd, record, sizeof(record)) == static_cast<ssize_t>(sizeof(record)) &&
+                record[1] == ~record[0]) {
+                positions[name.substr(0, name.size() - suffix_len)] = record[0];
+            }
+            ::close(fd);
+        }
+        ::closedir(dir);
+        return positions;
+    }
+
+#if QUEUE_PERF_STATS
+    /**
+     * @brief 获取性能统计信息
+     */
+    std::string get_stats() const {
+        return stats_.get_stats();
+    }
+
+    /**
+     * @brief 重置统计信息
+     */
+    void reset_stats() {
+        stats_.reset();
+    }
+#endif
+
+private:
+    // 记录大小: 记录头 + 消息，按8字节对齐
+    static constexpr size_t RECORD_SIZE =
+        (sizeof(JournalRecordHeader) + sizeof(T) + 7) / 8 * 8;
+    static constexpr const char* SEGMENT_PREFIX = "journal-";
+    static constexpr const char* SEGMENT_SUFFIX = ".seg";
+    static constexpr const char* POSITION_SUFFIX = ".position";
+
+    /**
+     * @brief 一个已映射的段文件
+     */
+    struct MappedSegment {
+        int fd = -1;
+        char* base = nullptr;
+        size_t mapped_size = 0;
+        uint64_t first_sequence = 0;
+        size_t count = 0;     // 已写入的记录数
+        size_t synced = 0;    // 已落盘的记录数
+    };
+
+    /**
+     * @brief 目录中的一个段文件
+     */
+    struct SegmentFile {
+        std::string path;
+        uint64_t first_sequence;
+    };
+
+    JournalOptions options_;
+    size_t page_size_ = 0;
+    size_t data_offset_ = 0;          // 记录区在段文件中的偏移
+    size_t segment_capacity_ = 0;     // 每段可容纳的记录数
+    MappedSegment segment_;           // 当前写入的段
+    std::atomic<uint64_t> next_sequence_{1};  // 下一条记录的序号，记录写完后以release发布给 replay()
+    std::atomic<uint64_t> synced_sequence_{1};  // 已落盘的记录之后的第一个序号
+    size_t unsynced_ = 0;             // 上次落盘后写入的记录数
+    uint64_t last_sync_ticks_ = 0;    // 上次落盘时间
+
+#if QUEUE_PERF_STATS
+    JournalStats stats_;
+#endif
+
+    static uint32_t checksum(uint64_t sequence, const void* payload) {
+        uint32_t hash = 2166136261u;
+        auto mix = [&hash](const void* data, size_t size) {
+            const auto* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+        };
+        mix(&sequence, sizeof(sequence));
+        mix(payload, sizeof(T));
+        return hash;
+    }
+
+    /**
+     * @brief 在当前段末尾写入一条记录，段已满时先切换段
+     * @param value 消息，nullptr 表示写入空洞记录
+     * @return 记录的序号
+     */
+    uint64_t write_record(const T* value) {
+        if (segment_.base == nullptr || segment_.count == segment_capacity_) {
+            roll_segment();
+        }
+
+        const uint64_t sequence = next_sequence_.load(std::memory_order_relaxed);
+        char* record = segment_.base + data_offset_ + segment_.count * RECORD_SIZE;
+        char* payload = record + sizeof(JournalRecordHeader);
+        if (value != nullptr) {
+            std::memcpy(payload, value, sizeof(T));
+        } else {
+            std::memset(payload, 0, sizeof(T));
+        }
+        JournalRecordHeader header{sequence, checksum(sequence, payload),
+                                   value != nullptr ? 0 : JOURNAL_RECORD_HOLE};
+        std::memcpy(record, &header, sizeof(header));
+        segment_.count++;
+        unsynced_++;
+        next_sequence_.store(sequence + 1, std::memory_order_release);
+        return sequence;
+    }
+
+    /**
+     * @brief 读取并校验段中的一条记录
+     * @param hole 输出: 是否为空洞记录
+     * @return 记录序号与期望一致且校验和正确时返回true
+     */
+    bool read_record(const MappedSegment& segment, size_t index, uint64_t expected_sequence,
+                     T& value, bool& hole) const {
+        const char* record = segment.base + data_offset_ + index * RECORD_SIZE;
+        JournalRecordHeader header;
+        std::memcpy(&header, record, sizeof(header));
+        if (header.sequence != expected_sequence) {
+            return false;
+        }
+        const char* payload = record + sizeof(JournalRecordHeader);
+        std::memcpy(&value, payload, sizeof(T));
+        hole = (header.flags & JOURNAL_RECORD_HOLE) != 0;
+        return header.checksum == checksum(expected_sequence, payload);
+    }
+
+    std::string segment_path(uint64_t first_sequence) const {
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s%020llu%s", SEGMENT_PREFIX,
+                      static_cast<unsigned long long>(first_sequence), SEGMENT_SUFFIX);
+        return options_.directory + "/" + name;
+    }
+
+    /**
+     * @brief 按首条序号升序列出目录中的段文件
+     */
+    std::vector<SegmentFile> list_segments() const {
+        std::vector<SegmentFile> segments;
+        DIR* dir = ::opendir(options_.directory.c_str());
+        if (!dir) {
+            return segments;
+        }
+        const size_t prefix_len = std::strlen(SEGMENT_PREFIX);
+        const size_t suffix_len = std::strlen(SEGMENT_SUFFIX);
+        while (dirent* entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name.size() <= prefix_len + suffix_len ||
+                name.compare(0, prefix_len, SEGMENT_PREFIX) != 0 ||
+                name.compare(name.size() - suffix_len, suffix_len, SEGMENT_SUFFIX) != 0) {
+                continue;
+            }
+            const std::string digits = name.substr(prefix_len, name.size() - prefix_len - suffix_len);
+            segments.push_back({options_.directory + "/" + name, std::stoull(digits)});
+        }
+        ::closedir(dir);
+        std::sort(segments.begin(), segments.end(),
+                  [](const SegmentFile& a, const SegmentFile& b) {
+                      return a.first_sequence < b.first_sequence;
+                  });
+        return segments;
+    }
+
+    /**
+     * @brief 打开并映射一个段文件，校验段文件头
+     * @throw std::system_error 打开或映射失败
+     * @throw std::runtime_error 段文件格式与 T 不匹配
+     */
+    MappedSegment map_segment(const std::string& path, int open_flags, int prot) const {
+        MappedSegment segment;
+        segment.mapped_size = data_offset_ + segment_capacity_ * RECORD_SIZE;
+        segment.fd = ::open(path.c_str(), open_flags | O_CLOEXEC, 0644);
+        if (segment.fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        if ((open_flags & O_CREAT) &&
+            ::ftruncate(segment.fd, static_cast<off_t>(segment.mapped_size)) != 0) {
+            const int error = errno;
+            close_segment(segment);
+            throw std::system_error(error, std::generic_category(), "ftruncate " + path);
+        }
+        struct stat st {};
+        if (::fstat(segment.fd, &st) != 0 || static_cast<size_t>(st.st_size) < segment.mapped_size) {
+            close_segment(segment);
+            throw std::runtime_error("日志段文件大小与配置不符: " + path);
+        }
+        void* mem = ::mmap(nullptr, segment.mapped_size, prot, MAP_SHARED, segment.fd, 0);
+        if (mem == MAP_FAILED) {
+            const int error = errno;
+            close_segment(segment);
+            throw std::system_error(error, std::generic_category(), "mmap " + path);
+        }
+        segment.base = static_cast<char*>(mem);
+
+        if (open_flags & O_CREAT) {
+            return segment;
+        }
+        JournalSegmentHeader header;
+        std::memcpy(&header, segment.base, sizeof(header));
+        if (std::memcmp(header.magic, JournalSegmentHeader::MAGIC, sizeof(header.magic)) != 0 ||
+            header.record_size != RECORD_SIZE || header.payload_size != sizeof(T) ||
+            header.capacity != segment_capacity_) {
+            close_segment(segment);
+            throw std::runtime_error("日志段文件格式与消息类型或段大小不匹配: " + path);
+        }
+        segment.first_sequence = header.first_sequence;
+        return segment;
+    }
+
+    static void close_segment(MappedSegment& segment) {
+        if (segment.base != nullptr) {
+            ::munmap(segment.base, segment.mapped_size);
+            segment.base = nullptr;
+        }
+        if (segment.fd >= 0) {
+            ::close(segment.fd);
+            segment.fd = -1;
+        }
+    }
+
+    /**
+     * @brief 段文件是否已完整创建(大小正确且文件头已写入魔数)
+     */
+    bool segment_initialized(const std::string& path) const {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st {};
+        char magic[sizeof(JournalSegmentHeader::MAGIC)] = {};
+        const bool initialized =
+            ::fstat(fd, &st) == 0 &&
+            static_cast<size_t>(st.st_size) >= data_offset_ + segment_capacity_ * RECORD_SIZE &&
+            ::pread(fd, magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic)) &&
+            std::memcmp(magic, JournalSegmentHeader::MAGIC, sizeof(magic)) == 0;
+        ::close(fd);
+        return initialized;
+    }
+
+    /**
+     * @brief 打开目录时恢复写入位置: 扫描最后一个段，从最后一条有效记录之后继续追加
+     */
+    void recover() {
+        auto segments = list_segments();
+        // 切换段时崩溃可能留下未写完文件头的新段，其中不会有记录，直接删除
+        while (!segments.empty() && !segment_initialized(segments.back().path)) {
+            ::unlink(segments.back().path.c_str());
+            segments.pop_back();
+        }
+        if (segments.empty()) {
+            return;
+        }
+        segment_ = map_segment(segments.back().path, O_RDWR, PROT_READ | PROT_WRITE);
+        T value;
+        bool hole = false;
+        while (segment_.count < segment_capacity_ &&
+               read_record(segment_, segment_.count, segment_.first_sequence + segment_.count,
+                           value, hole)) {
+            segment_.count++;
+        }
+        segment_.synced = segment_.count;
+        next_sequence_.store(segment_.first_sequence + segment_.count, std::memory_order_release);
+        synced_sequence_.store(next_sequence_.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+    /**
+     * @brief 落盘并关闭当前段，创建以下一条序号命名的新段
+     */
+    void roll_segment() {
+        if (segment_.base != nullptr) {
+            sync();
+            close_segment(segment_);
+#if QUEUE_PERF_STATS
+            stats_.record_segment_rolled();
+#endif
+        }
+        const uint64_t first_sequence = next_sequence_.load(std::memory_order_relaxed);
+        segment_ = map_segment(segment_path(first_sequence), O_RDWR | O_CREAT | O_EXCL,
+                               PROT_READ | PROT_WRITE);
+        JournalSegmentHeader header{};
+        std::memcpy(header.magic, JournalSegmentHeader::MAGIC, sizeof(header.magic));
+        header.record_size = static_cast<uint32_t>(RECORD_SIZE);
+        header.payload_size = static_cast<uint32_t>(sizeof(T));
+        header.first_sequence = first_sequence;
+        header.capacity = segment_capacity_;
+        std::memcpy(segment_.base, &header, sizeof(header));
+        segment_.first_sequence = first_sequence;
+    }
+};
+
+/**
+ * @brief 把队列中的每条消息写入日志的读取器
+ * @tparam T 数据类型
+ * @tparam Capacity 队列容量
+ *
+ * 作为独立的观察者线程运行，写日志和落盘都不占用生产者的关键路径。
+ * 队列为空时按 sync_interval_us 检查落盘，最后一批记录不必等到下一条消息；停止时把剩余记录落盘。
+ *
+ * 在空队列上启动时，日志序号 = 队列序号 + 1，
+ * 其他读取器在 on_gap(from, to) 中可用 journal.replay(from + 1, to + 1, ...) 补齐缺失的消息。
+ * 要让日志不丢消息，消费者需 depends_on(journal_reader.cursor())，在写入日志之后才取走；
+ * 溢出策略挤出或覆盖的消息仍可能在写入日志之前就丢失。此时本读取器写入等量的空洞记录，
+ * 序号对应关系保持不变，丢失的条数见 lost_count()。
+ *
+ * 写日志或落盘失败后不再写入(之后的序号无法保证对应)，failed() 变为true，
+ * 异常由 error() 取出；stop() 中最后一次落盘失败时直接抛出。
+ */
+template<typename T, size_t Capacity>
+class JournalReader : public LockFreeQueueReader<JournalReader<T, Capacity>, T, Capacity> {
+private:
+    using Base = LockFreeQueueReader<JournalReader<T, Capacity>, T, Capacity>;
+    friend Base;  // 允许基类访问on_data和on_gap
+
+    Journal<T>& journal_;
+    uint64_t lost_ = 0;                      // 写入日志之前就已丢失的消息数
+    std::atomic<bool> failed_{false};        // 写日志或落盘已失败
+    std::exception_ptr error_;               // 第一次失败的异常，failed_ 置位之前写入
+
+    void on_data(const T& data) {
+        if (failed_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            journal_.append(data);
+        } catch (const std::exception&) {
+            fail();
+        }
+    }
+
+    void on_gap(uint64_t from, uint64_t to) {
+        lost_ += to - from;
+        if (failed_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            journal_.append_holes(to - from);
+        } catch (const std::exception&) {
+            fail();
+        }
+    }
+
+    void on_idle() {
+        if (failed_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            journal_.maybe_sync();
+        } catch (const std::exception&) {
+            fail();
+        }
+    }
+
+    void fail() {
+        error_ = std::current_exception();
+        failed_.store(true, std::memory_order_release);
+    }
+
+public:
+    JournalReader(NBQueue<T, Capacity>& queue, Journal<T>& journal)
+        : Base(queue), journal_(journal) {}
+
+    ~JournalReader() {
+        Base::stop();
+        if (!failed()) {
+            try {
+                journal_.sync();
+            } catch (const std::system_error&) {
+            }
+        }
+    }
+
+    /**
+     * @brief 停止读取器并把剩余记录落盘
+     * @throw std::system_error 落盘失败
+     */
+    void stop() {
+        Base::stop();
+        if (!failed()) {
+            journal_.sync();
+        }
+    }
+
+    /**
+     * @brief 写日志或落盘是否已失败
+     */
+    bool failed() const {
+        return failed_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 第一次失败的异常，没有失败时为空，需在 failed() 返回true之后读取
+     */
+    std::exception_ptr error() const {
+        return failed() ? error_ : nullptr;
+    }
+
+    /**
+     * @brief 写入日志之前就已丢失、以空洞记录代替的消息数，需在stop()之后读取
+     */
+    uint64_t lost_count() const {
+        return lost_;
+    }
+};
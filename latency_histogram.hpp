@@ -0,0 +1,192 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include "timer.hpp"
+
+/**
+ * @brief 对数-线性分桶的延迟直方图
+ *
+ * 以计数器原始值(HighResolutionTimer::now()的差值)为单位记录样本，
+ * 输出时再转换为纳秒。分桶方式类似 HdrHistogram:
+ * - 按最高有效位分组(2的幂区间)
+ * - 每组再线性细分为 SUB_BUCKETS 个子桶
+ * 相对误差不超过 1/SUB_BUCKETS，记录一次只需几条整数指令，
+ * 没有任何内存分配，适合放在热路径上。
+ *
+ * 非线程安全: 每个线程各自记录，最后用 merge() 合并。
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 4;                     // 每组细分的位数
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS; // 每组子桶数
+    static constexpr size_t GROUPS = 64 - SUB_BUCKET_BITS + 1;       // 分组数
+    static constexpr size_t BUCKETS = GROUPS * SUB_BUCKETS;          // 总桶数
+
+    /**
+     * @brief 记录一个样本
+     * @param ticks 计数器值差值(end - start)
+     */
+    void record(uint64_t ticks) noexcept {
+        counts_[bucket_index(ticks)]++;
+        total_count_++;
+        total_ticks_ += ticks;
+        if (ticks > max_ticks_) {
+            max_ticks_ = ticks;
+        }
+        if (ticks < min_ticks_) {
+            min_ticks_ = ticks;
+        }
+    }
+
+    /**
+     * @brief 合并另一个直方图的样本
+     */
+    void merge(const LatencyHistogram& other) noexcept {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_count_ += other.total_count_;
+        total_ticks_ += other.total_ticks_;
+        if (other.max_ticks_ > max_ticks_) {
+            max_ticks_ = other.max_ticks_;
+        }
+        if (other.min_ticks_ < min_ticks_) {
+            min_ticks_ = other.min_ticks_;
+        }
+    }
+
+    /**
+     * @brief 清空所有样本
+     */
+    void reset() noexcept {
+        counts_.fill(0);
+        total_count_ = 0;
+        total_ticks_ = 0;
+        max_ticks_ = 0;
+        min_ticks_ = UINT64_MAX;
+    }
+
+    uint64_t count() const noexcept { return total_count_; }
+    uint64_t max() const noexcept { return max_ticks_; }
+    uint64_t min() const noexcept { return total_count_ ? min_ticks_ : 0; }
+
+    /**
+     * @brief 平均值(计数器原始值)
+     */
+    double mean() const noexcept {
+        return total_count_ ? static_cast<double>(total_ticks_) / total_count_ : 0.0;
+    }
+
+    /**
+     * @brief 获取指定百分位的值
+     * @param percentile 百分位(0-100)
+     * @return 该百分位所在桶的上界(计数器原始值)，不超过实际最大值
+     */
+    uint64_t value_at_percentile(double percentile) const noexcept {
+        if (total_count_ == 0) {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * total_count_ + 0.5);
+        if (target == 0) {
+            target = 1;
+        }
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= target) {
+                const uint64_t upper = bucket_upper_bound(i);
+                return upper < max_ticks_ ? upper : max_ticks_;
+            }
+        }
+        return max_ticks_;
+    }
+
+    /**
+     * @brief 获取统计摘要(纳秒)
+     * @param scale 输出前对每个值乘以的系数，例如RTT换算单向延迟时传0.5
+     * @return 包含样本数、均值、各百分位和最值的格式化字符串
+     */
+    std::string get_stats(double scale = 1.0) const {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        ss << "  样本数: " << total_count_ << "\n";
+        if (total_count_ == 0) {
+            return ss.str();
+        }
+        ss << "  最小: " << HighResolutionTimer::to_ns(min()) * scale << " ns\n";
+        ss << "  平均: " << HighResolutionTimer::to_ns(1) * mean() * scale << " ns\n";
+        constexpr std::pair<double, const char*> PERCENTILES[] = {
+            {50.0, "P50"}, {90.0, "P90"}, {99.0, "P99"}, {99.9, "P99.9"}, {99.99, "P99.99"}};
+        for (const auto& [p, label] : PERCENTILES) {
+            ss << "  " << label << ": "
+               << HighResolutionTimer::to_ns(value_at_percentile(p)) * scale << " ns\n";
+        }
+        ss << "  最大: " << HighResolutionTimer::to_ns(max_ticks_) * scale << " ns\n";
+        return ss.str();
+    }
+
+    /**
+     * @brief 输出非空桶的分布(纳秒)
+     * @param scale 输出前对每个值乘以的系数
+     */
+    std::string get_distribution(double scale = 1.0) const {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            if (counts_[i] == 0) {
+                continue;
+            }
+            seen += counts_[i];
+            ss << "  <= " << std::setw(12)
+               << HighResolutionTimer::to_ns(bucket_upper_bound(i)) * scale << " ns: "
+               << std::setw(12) << counts_[i] << "  ("
+               << std::setw(7) << std::setprecision(3)
+               << 100.0 * seen / total_count_ << "%)\n"
+               << std::setprecision(1);
+        }
+        return ss.str();
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> counts_{};  // 各桶样本数
+    uint64_t total_count_{0};                 // 样本总数
+    uint64_t total_ticks_{0};                 // 样本总和
+    uint64_t max_ticks_{0};                   // 最大样本
+    uint64_t min_ticks_{UINT64_MAX};          // 最小样本
+
+    /**
+     * @brief 计算样本所在的桶
+     *
+     * 小于 SUB_BUCKETS 的值直接落在第0组；其余按最高有效位确定组号，
+     * 再取最高有效位之后的 SUB_BUCKET_BITS 位作为组内子桶号。
+     */
+    static size_t bucket_index(uint64_t value) noexcept {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        const size_t msb = 63 - static_cast<size_t>(__builtin_clzll(value));
+        const size_t group = msb - SUB_BUCKET_BITS + 1;
+        const size_t sub = static_cast<size_t>(value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return group * SUB_BUCKETS + sub;
+    }
+
+    /**
+     * @brief 桶的上界(包含)
+     */
+    static uint64_t bucket_upper_bound(size_t index) noexcept {
+        const size_t group = index / SUB_BUCKETS;
+        const uint64_t sub = index % SUB_BUCKETS;
+        if (group == 0) {
+            return sub;
+        }
+        const size_t shift = group - 1;
+        const uint64_t lower = (SUB_BUCKETS + sub) << shift;
+        return lower + ((uint64_t{1} << shift) - 1);
+    }
+};
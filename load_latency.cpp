@@ -0,0 +1,220 @@
+#include "queue.hpp"
+#include "lock_free_queue_producer.hpp"
+#include "latency_histogram.hpp"
+#include "send_schedule.hpp"
+#include "capture.hpp"
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+#include "timer.hpp"
+#include "test_data.hpp"
+
+/**
+ * @brief 负载-延迟曲线测试参数
+ */
+constexpr size_t LOAD_QUEUE_CAPACITY = 4096;                 // 队列容量
+constexpr auto DEFAULT_DURATION = std::chrono::seconds(2);   // 每个负载点的默认持续时间
+
+using LoadQueue = NBQueue<TestData, LOAD_QUEUE_CAPACITY>;
+
+static inline void cpu_relax() {
+    #if defined(__x86_64__)
+        _mm_pause();
+    #elif defined(__aarch64__)
+        asm volatile("yield");
+    #endif
+}
+
+/**
+ * @brief 单个负载点的结果
+ */
+struct LoadPoint {
+    double offered_rate;               // 目标发送速率(消息/秒)
+    double achieved_rate;              // 实际消费速率(消息/秒)
+    LatencyHistogram send_latency;     // 预定时间 -> 发布成功
+    LatencyHistogram end_to_end;       // 预定时间 -> 被消费
+};
+
+/**
+ * @brief 按给定发送计划运行一个开环生产者和一个消费者
+ * @param schedule 发送计划(固定速率、泊松或回放录制的节奏)
+ * @param duration 持续时间
+ * @param replay 回放的录制流量，为空时使用 DataGenerator 生成随机数据
+ * @param capture 录制消费者收到的流量，为空时不录制
+ */
+static LoadPoint run_load_point(SendSchedule schedule, std::chrono::milliseconds duration,
+                                const TrafficCapture<TestData>* replay,
+                                CaptureWriter<TestData>* capture) {
+    auto queue = std::make_unique<LoadQueue>();
+    DataGenerator generator;
+    LoadPoint point{schedule.rate(), 0, {}, {}};
+
+    // 生成器接收预定发送时间并写入消息
+    std::function<TestData()> next_record;
+    if (replay) {
+        next_record = replay->generator();
+    } else {
+        next_record = [&generator] { return generator.generate(); };
+    }
+    LockFreeQueueProducer producer(*queue, [&next_record](uint64_t intended) {
+        TestData data = next_record();
+        data.timestamp = intended;
+        return data;
+    });
+    producer.set_send_schedule(std::move(schedule));
+    // 背压时保留消息重试，排队时间计入延迟而不是变成丢包
+    producer.set_overflow_policy(OverflowPolicy::Block);
+
+    // 消费者按消息中的预定发送时间计算端到端延迟
+    std::atomic<bool> consuming{true};
+    size_t consumed = 0;
+    std::thread consumer([&]() {
+        while (consuming.load(std::memory_order_relaxed)) {
+            auto data = queue->pop();
+            if (!data) {
+                cpu_relax();
+                continue;
+            }
+            const auto now = HighResolutionTimer::now();
+            point.end_to_end.record(now - data->timestamp);
+            if (capture) {
+                try {
+                    capture->write(now, *data);
+                } catch (const std::system_error& e) {
+                    std::cerr << "录制失败，本轮不再录制: " << e.what() << "\n";
+                    capture = nullptr;
+                }
+            }
+            ++consumed;
+        }
+    });
+
+    const auto start = HighResolutionTimer::now();
+    producer.start();
+    std::this_thread::sleep_for(duration);
+    producer.stop();
+    consuming.store(false);
+    consumer.join();
+    const auto end = HighResolutionTimer::now();
+
+    point.achieved_rate = consumed / HighResolutionTimer::to_sec(end - start);
+    point.send_latency = producer.send_latency();
+    return point;
+}
+
+static void print_usage(const char* prog) {
+    std::cout << "用法: " << prog << " [--poisson] [--duration-ms N] [--capture 文件] 速率1 [速率2 ...]\n"
+              << "      " << prog << " --replay 文件 [--duration-ms N] [--capture 文件] 倍速1 [倍速2 ...]\n"
+              << "  速率单位为消息/秒，例如: " << prog << " 10000 100000 1000000\n"
+              << "  --replay 按录制文件中的到达间隔回放，倍速1为原始节奏，例如: "
+              << prog << " --replay burst.cap 1 2 4\n"
+              << "  --capture 把消费者收到的消息和接收时间录制到文件，供之后回放\n";
+}
+
+/**
+ * @brief 按一组目标速率测量开环延迟，输出负载-延迟曲线(微秒)
+ */
+int main(int argc, char** argv) {
+    bool poisson = false;
+    std::chrono::milliseconds duration = DEFAULT_DURATION;
+    std::string replay_path;
+    std::string capture_path;
+    std::vector<double> rates;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--poisson") {
+            poisson = true;
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (arg == "--capture" && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (arg == "--duration-ms" && i + 1 < argc) {
+            duration = std::chrono::milliseconds(std::strtoull(argv[++i], nullptr, 10));
+        } else {
+            const double rate = std::strtod(argv[i], nullptr);
+            if (rate <= 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            rates.push_back(rate);
+        }
+    }
+    if (rates.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 初始化高精度计时器
+    HighResolutionTimer::init();
+
+    std::unique_ptr<TrafficCapture<TestData>> replay;
+    std::unique_ptr<CaptureWriter<TestData>> capture;
+    try {
+        if (!replay_path.empty()) {
+            replay = std::make_unique<TrafficCapture<TestData>>(
+                TrafficCapture<TestData>::load(replay_path));
+            std::cout << "回放 " << replay_path << ": " << replay->size() << " 条消息, 时长 "
+                      << replay->duration_sec() << " 秒" << std::endl;
+        }
+        if (!capture_path.empty()) {
+            capture = std::make_unique<CaptureWriter<TestData>>(capture_path);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::vector<LoadPoint> points;
+    for (double rate : rates) {
+        if (replay) {
+            std::cout << "运行 " << rate << " 倍速回放 ..." << std::endl;
+            points.push_back(run_load_point(replay->schedule(rate), duration, replay.get(), capture.get()));
+        } else {
+            std::cout << "运行 " << rate << " 消息/秒 ..." << std::endl;
+            points.push_back(run_load_point(
+                poisson ? SendSchedule::poisson(rate) : SendSchedule::fixed_rate(rate),
+                duration, nullptr, capture.get()));
+        }
+    }
+    if (capture) {
+        try {
+            capture->close();
+        } catch (const std::system_error& e) {
+            std::cerr << "录制文件不完整: " << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "已录制 " << capture->record_count() << " 条消息到 " << capture_path << std::endl;
+    }
+
+    auto us = [](uint64_t ticks) { return HighResolutionTimer::to_us(ticks); };
+    std::cout << "\n=== 负载-延迟曲线 ("
+              << (replay ? "回放录制流量" : poisson ? "泊松到达" : "固定速率")
+              << ", 延迟从预定发送时间算起, 单位us) ===\n";
+    std::cout << std::left << std::setw(14) << "目标速率" << std::setw(14) << "实际速率"
+              << std::setw(12) << "发送P50" << std::setw(12) << "发送P99"
+              << std::setw(12) << "端到端P50" << std::setw(12) << "端到端P99"
+              << std::setw(12) << "端到端P99.9" << std::setw(12) << "端到端最大" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& p : points) {
+        std::cout << std::setw(14) << std::setprecision(0) << p.offered_rate
+                  << std::setw(14) << p.achieved_rate << std::setprecision(2)
+                  << std::setw(12) << us(p.send_latency.value_at_percentile(50))
+                  << std::setw(12) << us(p.send_latency.value_at_percentile(99))
+                  << std::setw(12) << us(p.end_to_end.value_at_percentile(50))
+                  << std::setw(12) << us(p.end_to_end.value_at_percentile(99))
+                  << std::setw(12) << us(p.end_to_end.value_at_percentile(99.9))
+                  << std::setw(12) << us(p.end_to_end.max()) << "\n";
+    }
+    return 0;
+}
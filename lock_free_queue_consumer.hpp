@@ -0,0 +1,336 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "timer.hpp"
+#include "backoff.hpp"
+#include "span.hpp"
+#include "thread_options.hpp"
+#include "queue.hpp"
+#include "sequence_barrier.hpp"
+
+/**
+ * @brief 队列消费者性能统计类
+ */
+#if QUEUE_READER_PERF_STATS
+class QueueConsumerStats {
+public:
+    void record_successful_pop(uint64_t start_time, size_t count) {
+        const auto end_time = HighResolutionTimer::now();
+        const auto duration = end_time - start_time;
+
+        consumed += count;
+        pop_calls++;
+        total_ticks += duration;
+        update_max_min_time(duration);
+    }
+
+    void record_empty_pop() {
+        empty_pops++;
+    }
+
+    void record_barrier_wait() {
+        barrier_waits++;
+    }
+
+    void record_backoff(uint64_t ticks) {
+        backoff_count++;
+        backoff.record_pause(ticks);
+    }
+
+    void record_wake(uint64_t ticks) {
+        backoff.record_wake(ticks);
+    }
+
+    void record_arrival_interval(uint64_t ticks) {
+        backoff.record_interval(ticks);
+    }
+
+    std::string get_stats() const {
+        std::stringstream ss;
+        ss << "消费者性能统计:\n";
+
+        const auto count = consumed.load();
+        const auto calls = pop_calls.load();
+
+        ss << "消费消息数: " << count << "\n";
+        ss << "成功取出次数: " << calls << "\n";
+        ss << "空取出次数: " << empty_pops.load() << "\n";
+        ss << "回退次数: " << backoff_count.load() << "\n";
+        ss << backoff.get_stats();
+        ss << "等待上游次数: " << barrier_waits.load() << "\n";
+        if (calls > 0) {
+            ss << "平均批量大小: " << static_cast<double>(count) / calls << "\n";
+
+            const auto avg_ns = HighResolutionTimer::to_ns(total_ticks.load() / calls);
+            const auto max_ns = HighResolutionTimer::to_ns(max_ticks.load());
+            const auto min_ns = HighResolutionTimer::to_ns(min_ticks.load());
+
+            ss << "平均取出耗时: " << avg_ns << " ns\n";
+            ss << "最大取出耗时: " << max_ns << " ns\n";
+            ss << "最小取出耗时: " << min_ns << " ns\n";
+        }
+
+        return ss.str();
+    }
+
+    void reset() {
+        consumed = 0;
+        pop_calls = 0;
+        empty_pops = 0;
+        backoff_count = 0;
+        backoff.reset();
+        barrier_waits = 0;
+        total_ticks = 0;
+        max_ticks = 0;
+        min_ticks = UINT64_MAX;
+    }
+
+private:
+    std::atomic<size_t> consumed{0};            // 取出的消息总数
+    std::atomic<size_t> pop_calls{0};           // 取到消息的次数
+    std::atomic<size_t> empty_pops{0};          // 队列为空的次数
+    std::atomic<size_t> backoff_count{0};
+    BackoffStats backoff;                       // 回退时长、唤醒延迟和消息到达间隔
+    std::atomic<size_t> barrier_waits{0};       // 队列非空但上游阶段还没处理完的次数
+    std::atomic<uint64_t> total_ticks{0};
+    std::atomic<uint64_t> max_ticks{0};
+    std::atomic<uint64_t> min_ticks{UINT64_MAX};
+
+    void update_max_min_time(uint64_t duration) {
+        uint64_t current_max = max_ticks.load();
+        while(duration > current_max &&
+              !max_ticks.compare_exchange_weak(current_max, duration));
+
+        uint64_t current_min = min_ticks.load();
+        while(duration < current_min &&
+              !min_ticks.compare_exchange_weak(current_min, duration));
+    }
+};
+#endif
+
+/**
+ * @brief 高性能无锁队列消费者，使用CRTP模式
+ * @tparam Derived 派生类类型
+ * @tparam T 数据类型
+ * @tparam Capacity 队列容量
+ *
+ * 与 LockFreeQueueReader 不同，消费者会把消息从队列中取走，为生产者腾出空间:
+ * 1. 通过 pop_bulk 一次认领一段连续消息，按移动方式取出
+ * 2. 多个消费者可以共享同一个队列，每条消息只交给其中一个
+ * 3. 使用自旋等待和按到达间隔自适应的回退策略(见 AdaptiveBackoff)
+ * 4. 通过CRTP实现零开销的数据处理回调
+ *
+ * 派生类实现 on_data(T&&) 逐条处理；如果实现了 on_batch(Span<T>)，
+ * 则每次拿到一批(最多 batch_size 条)批量处理，on_data 不再被调用。
+ * 批量中的消息归派生类所有，可以继续移走。
+ * 同一批消息在队列中是连续的，但多个消费者之间的处理顺序不做保证，需要按键有序时
+ * 使用 RoutingQueueProducer 分片，每个分片只配一个消费者。
+ *
+ * 作为多阶段流水线的最后一环时，用 depends_on() 依赖最后一个阶段的进度，
+ * 消息要等所有阶段都处理完才会被取走。
+ */
+template<typename Derived, typename T, size_t Capacity>
+class LockFreeQueueConsumer {
+private:
+    static constexpr size_t DEFAULT_BATCH_SIZE = 64;   // 每次最多取出的条数
+
+    // 检测派生类是否实现了 on_batch(Span<T>)
+    template<typename D, typename = void>
+    struct has_on_batch : std::false_type {};
+    template<typename D>
+    struct has_on_batch<D, std::void_t<decltype(std::declval<D&>().on_batch(std::declval<Span<T>>()))>>
+        : std::true_type {};
+
+    NBQueue<T, Capacity>& queue_;    // 被消费的队列
+    std::atomic<bool> running_{false};         // 运行状态标志
+    std::thread consumer_thread_;              // 消费者线程
+    size_t batch_size_ = DEFAULT_BATCH_SIZE;   // 每次最多取出的条数
+    SequenceBarrier barrier_;                  // 依赖的上游阶段
+
+#if QUEUE_READER_PERF_STATS
+    QueueConsumerStats stats_;
+#endif
+
+    /**
+     * @brief 取出一批消息并交给派生类处理
+     * @param batch 本地缓冲区，取出的消息移动到其前缀中
+     * @return 取出的消息数，0表示队列为空
+     */
+    size_t consume_available(std::vector<T>& batch) {
+#if QUEUE_READER_PERF_STATS
+        const auto start_time = HighResolutionTimer::now();
+#endif
+        const uint64_t limit = barrier_.available();
+        const size_t count = queue_.pop_bulk(Span<T>(batch.data(), batch.size()), limit);
+        if (count == 0) {
+#if QUEUE_READER_PERF_STATS
+            if (queue_.head_sequence() >= limit && limit < queue_.tail_sequence()) {
+                stats_.record_barrier_wait();
+            }
+#endif
+            return 0;
+        }
+#if QUEUE_READER_PERF_STATS
+        stats_.record_successful_pop(start_time, count);
+#endif
+        if constexpr (has_on_batch<Derived>::value) {
+            static_cast<Derived*>(this)->on_batch(Span<T>(batch.data(), count));
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                static_cast<Derived*>(this)->on_data(std::move(batch[i]));
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @brief 消费者线程主函数
+     */
+    void consume() {
+        AdaptiveBackoff backoff;     // 回退状态
+        bool was_empty = false;      // 上次取出是否为空
+        std::vector<T> batch(batch_size_);
+
+        while (running_.load(std::memory_order_relaxed)) {
+            const size_t count = consume_available(batch);
+            if (count > 0) {
+                [[maybe_unused]] const uint64_t wake_ticks = backoff.on_progress(count);
+#if QUEUE_READER_PERF_STATS
+                if (wake_ticks > 0) {
+                    stats_.record_wake(wake_ticks);
+                }
+#endif
+                was_empty = false;
+                continue;
+            }
+#if QUEUE_READER_PERF_STATS
+            stats_.record_empty_pop();
+#endif
+
+            if (!was_empty) {
+                // 第一次遇到空队列，立即重试
+                was_empty = true;
+                continue;
+            }
+
+            // 按消息到达间隔自适应的指数回退
+            [[maybe_unused]] const uint64_t pause_ticks = backoff.pause();
+#if QUEUE_READER_PERF_STATS
+            stats_.record_backoff(pause_ticks);
+            stats_.record_arrival_interval(backoff.interval_ticks());
+#endif
+        }
+    }
+
+protected:
+    /**
+     * @brief 构造函数
+     * @param queue 要消费的队列
+     */
+    explicit LockFreeQueueConsumer(NBQueue<T, Capacity>& queue)
+        : queue_(queue) {}
+
+public:
+    /**
+     * @brief 析构函数，确保线程安全停止
+     */
+    ~LockFreeQueueConsumer() {
+        stop();
+    }
+
+    /**
+     * @brief 启动消费者
+     * @param options 线程选项(绑核、SCHED_FIFO优先级、线程名)
+     * @return 线程选项的应用结果，语义同 LockFreeQueueReader::start
+     */
+    ThreadSetupResult start(const ThreadOptions& options = {}) {
+        if (running_.exchange(true)) {
+            return {};
+        }
+        std::promise<ThreadSetupResult> setup;
+        auto setup_result = setup.get_future();
+        consumer_thread_ = std::thread([this, options, setup = std::move(setup)]() mutable {
+            setup.set_value(apply_thread_options(options));
+            consume();
+        });
+        return setup_result.get();
+    }
+
+    /**
+     * @brief 停止消费者
+     *
+     * 已经取出的一批消息会处理完再退出，队列中剩余的消息保持不动。
+     */
+    void stop() {
+        if (running_.exchange(false)) {
+            if (consumer_thread_.joinable()) {
+                consumer_thread_.join();
+            }
+        }
+    }
+
+    /**
+     * @brief 依赖上游阶段: 只取走上游已处理完的消息，需在start()之前调用
+     * @param upstream 上游阶段的进度，例如读取器的 cursor()，需比本消费者存活更久
+     */
+    void depends_on(const SequenceCursor& upstream) {
+        barrier_.add(upstream);
+    }
+
+    /**
+     * @brief 设置每次最多取出的条数，需在start()之前调用
+     * @param batch_size 最大条数，至少为1
+     *
+     * 批量越大每条消息分摊的同步开销越小，但单个消费者一次占走的消息也越多，
+     * 多个消费者之间的负载会更不均匀。
+     */
+    void set_batch_size(size_t batch_size) {
+        batch_size_ = batch_size > 0 ? batch_size : 1;
+    }
+
+#if QUEUE_READER_PERF_STATS
+    /**
+     * @brief 获取性能统计信息
+     * @return 格式化的统计信息字符串
+     */
+    std::string get_stats() const {
+        return stats_.get_stats();
+    }
+
+    /**
+     * @brief 重置统计信息
+     */
+    void reset_stats() {
+        stats_.reset();
+    }
+#endif
+};
+
+/**
+ * @brief 使用示例：自定义队列消费者
+ */
+template<typename T, size_t Capacity>
+class MyQueueConsumer : public LockFreeQueueConsumer<MyQueueConsumer<T, Capacity>, T, Capacity> {
+private:
+    using Base = LockFreeQueueConsumer<MyQueueConsumer<T, Capacity>, T, Capacity>;
+    friend Base;  // 允许基类访问on_data
+
+    /**
+     * @brief 数据处理函数
+     * @param data 取出的数据，归消费者所有
+     */
+    void on_data(T&& data) {
+        // 在这里实现你的数据处理逻辑
+        (void)data;
+    }
+
+public:
+    explicit MyQueueConsumer(NBQueue<T, Capacity>& queue)
+        : Base(queue) {}
+};
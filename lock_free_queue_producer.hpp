@@ -2,7 +2,17 @@
 #include <atomic>
 #include <thread>
 #include <functional>
+#include <type_traits>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
 #include "timer.hpp"
+#include "backoff.hpp"
+#include "thread_options.hpp"
+#include "send_schedule.hpp"
+#include "latency_histogram.hpp"
+#include "spill_file.hpp"
 #include "queue.hpp"
 
 /**
@@ -24,12 +34,90 @@ public:
         update_max_min_time(duration);
     }
 
+    /**
+     * @brief 记录一次批量发布
+     * @param start_time 本轮开始时间
+     * @param count 本轮发布的消息数
+     *
+     * 平均耗时按消息数分摊，最大/最小耗时记录的是整轮批量的耗时。
+     */
+    void record_batch_success(uint64_t start_time, size_t count) {
+        const auto end_time = HighResolutionTimer::now();
+        const auto duration = end_time - start_time;
+
+        successful_produces += count;
+        batch_count++;
+        total_ticks += duration;
+        update_max_min_time(duration);
+    }
+
     void record_queue_full() {
         queue_full_count++;
     }
 
-    void record_backoff() {
+    void record_backoff(uint64_t ticks) {
         backoff_count++;
+        backoff.record_pause(ticks);
+    }
+
+    void record_wake(uint64_t ticks) {
+        backoff.record_wake(ticks);
+    }
+
+    void record_arrival_interval(uint64_t ticks) {
+        backoff.record_interval(ticks);
+    }
+
+    void record_dropped_newest() {
+        dropped_newest++;
+    }
+
+    void record_dropped_oldest(size_t count) {
+        dropped_oldest += count;
+    }
+
+    void record_overwritten() {
+        overwritten++;
+    }
+
+    void record_staged(size_t depth) {
+        staged++;
+        size_t current_max = max_staging_depth.load();
+        while (depth > current_max &&
+               !max_staging_depth.compare_exchange_weak(current_max, depth));
+    }
+
+    /**
+     * @brief 记录从暂存区补发进队列的消息，它们此时才算生产成功
+     *
+     * 补发的消息不计耗时，平均耗时只按直接写入队列的消息计算(record_resumed 同理)。
+     */
+    void record_staging_flushed(size_t count) {
+        staging_flushed += count;
+        successful_produces += count;
+    }
+
+    /**
+     * @brief 记录上次停止时保留、重新启动后写入队列的消息，不计耗时
+     */
+    void record_resumed(size_t count) {
+        resumed += count;
+        successful_produces += count;
+    }
+
+    void record_spilled(size_t depth) {
+        spilled++;
+        size_t current_max = max_spill_depth.load();
+        while (depth > current_max &&
+               !max_spill_depth.compare_exchange_weak(current_max, depth));
+    }
+
+    void record_restored(size_t count) {
+        restored += count;
+    }
+
+    void record_spill_full() {
+        spill_full_count++;
     }
 
     std::string get_stats() const {
@@ -44,9 +132,36 @@ public:
         ss << "成功生产次数: " << success << "\n";
         ss << "队列满次数: " << full << "\n";
         ss << "回退次数: " << backoff_count.load() << "\n";
+        ss << backoff.get_stats();
+        ss << "丢弃新消息数: " << dropped_newest.load() << "\n";
+        ss << "挤出旧消息数: " << dropped_oldest.load() << "\n";
+        ss << "覆盖消息数: " << overwritten.load() << "\n";
+        const auto staged_count = staged.load();
+        if (staged_count > 0) {
+            ss << "暂存消息数: " << staged_count << "\n";
+            ss << "暂存补发数: " << staging_flushed.load() << "\n";
+            ss << "最大暂存深度: " << max_staging_depth.load() << "\n";
+        }
+        const auto resumed_count = resumed.load();
+        if (resumed_count > 0) {
+            ss << "停止时保留、重启后发布的消息数: " << resumed_count << "\n";
+        }
+        const auto spilled_count = spilled.load();
+        if (spilled_count > 0) {
+            ss << "溢出到文件消息数: " << spilled_count << "\n";
+            ss << "从文件补回消息数: " << restored.load() << "\n";
+            ss << "最大溢出深度: " << max_spill_depth.load() << "\n";
+            ss << "溢出文件满次数: " << spill_full_count.load() << "\n";
+        }
+        const auto batches = batch_count.load();
+        if (batches > 0) {
+            ss << "批量发布次数: " << batches << "\n";
+            ss << "平均批量大小: " << static_cast<double>(success) / batches << "\n";
+        }
         
-        if (success > 0) {
-            const auto avg_ns = HighResolutionTimer::to_ns(total_ticks.load() / success);
+        const auto timed = success - staging_flushed.load() - resumed_count;
+        if (timed > 0) {
+            const auto avg_ns = HighResolutionTimer::to_ns(total_ticks.load() / timed);
             const auto max_ns = HighResolutionTimer::to_ns(max_ticks.load());
             const auto min_ns = HighResolutionTimer::to_ns(min_ticks.load());
             
@@ -63,6 +178,19 @@ public:
         successful_produces = 0;
         queue_full_count = 0;
         backoff_count = 0;
+        backoff.reset();
+        batch_count = 0;
+        dropped_newest = 0;
+        dropped_oldest = 0;
+        overwritten = 0;
+        staged = 0;
+        staging_flushed = 0;
+        max_staging_depth = 0;
+        resumed = 0;
+        spilled = 0;
+        restored = 0;
+        max_spill_depth = 0;
+        spill_full_count = 0;
         total_ticks = 0;
         max_ticks = 0;
         min_ticks = UINT64_MAX;
@@ -73,6 +201,19 @@ private:
     std::atomic<size_t> successful_produces{0}; // 成功生产次数
     std::atomic<size_t> queue_full_count{0};    // 队列满次数
     std::atomic<size_t> backoff_count{0};       // 回退次数
+    BackoffStats backoff;                       // 回退时长、唤醒延迟和空间释放间隔
+    std::atomic<size_t> batch_count{0};         // 批量发布次数
+    std::atomic<size_t> dropped_newest{0};      // DropNewest策略丢弃的新消息数
+    std::atomic<size_t> dropped_oldest{0};      // DropOldest策略从队列挤出的旧消息数
+    std::atomic<size_t> overwritten{0};         // OverwriteLatest策略覆盖的消息数
+    std::atomic<size_t> staged{0};              // 进入本地暂存区的消息数
+    std::atomic<size_t> staging_flushed{0};     // 从暂存区补发成功的消息数
+    std::atomic<size_t> max_staging_depth{0};   // 暂存区的最大深度
+    std::atomic<size_t> resumed{0};             // 停止时保留、重新启动后写入队列的消息数
+    std::atomic<size_t> spilled{0};             // 写入溢出文件的消息数
+    std::atomic<size_t> restored{0};            // 从溢出文件补回队列的消息数
+    std::atomic<size_t> max_spill_depth{0};     // 溢出文件的最大深度
+    std::atomic<size_t> spill_full_count{0};    // 溢出文件满、只能等待的次数
     std::atomic<uint64_t> total_ticks{0};       // 总耗时
     std::atomic<uint64_t> max_ticks{0};         // 最大耗时
     std::atomic<uint64_t> min_ticks{UINT64_MAX}; // 最小耗时
@@ -89,30 +230,336 @@ private:
 };
 #endif
 
+/**
+ * @brief 发布一条消息的结果
+ */
+enum class PublishResult {
+    Published,   // 已写入队列(或溢出文件)
+    Dropped,     // 按溢出策略丢弃
+    Stopped,     // 生产者已停止，消息既没有写入也没有丢弃，由调用方保留
+};
+
 /**
  * @brief 高性能无锁队列生产者
  * @tparam T 数据类型
  * @tparam Capacity 队列容量
+ * @tparam Generator 数据生成器类型，签名为以下之一:
+ *         - T(): 每次生成一条消息
+ *         - T(uint64_t 预定发送时间): 同上，开环模式下可把预定时间写入消息
+ *         - size_t(Span<T>): 批量生成，填充span的前若干个元素并返回个数
+ *           (例如一次recv收到多条消息)，生产循环用 push_bulk 批量发布
+ * @tparam OnQueueFull 队列满回调类型，签名为 void()
+ *
+ * 生成器和回调以模板参数保存，传入lambda或函数对象时调用可以被内联进生产循环，
+ * 不再经过 std::function 的间接调用。默认的 std::function 只是为了兼容和方便，
+ * 配合推导指引可以直接写 LockFreeQueueProducer producer(queue, [] { ... });
  */
-template<typename T, size_t Capacity>
+template<typename T, size_t Capacity,
+         typename Generator = std::function<T()>,
+         typename OnQueueFull = std::function<void()>>
 class LockFreeQueueProducer {
 private:
+    // 生成器是否批量生成
+    static constexpr bool BATCH_GENERATOR = std::is_invocable_r_v<size_t, Generator&, Span<T>>;
+    // 生成器是否接受预定发送时间参数
+    static constexpr bool TIMED_GENERATOR =
+        !BATCH_GENERATOR && std::is_invocable_r_v<T, Generator&, uint64_t>;
+    static_assert(BATCH_GENERATOR || TIMED_GENERATOR || std::is_invocable_r_v<T, Generator&>,
+                  "Generator 的签名必须是 T()、T(uint64_t) 或 size_t(Span<T>)");
+
+    static constexpr size_t DEFAULT_BATCH_SIZE = 64;   // 批量生成器的默认批量大小
+
     NBQueue<T, Capacity>& queue_;    // 目标队列
     std::atomic<bool> running_{false};         // 运行状态标志
     std::thread producer_thread_;              // 生产者线程
-    std::function<void()> on_queue_full_;      // 队列满时的回调函数
-    std::function<T()> data_generator_;        // 数据生成器
+    Generator data_generator_;                 // 数据生成器
+    OnQueueFull on_queue_full_;                // 队列满时的回调函数
+    SendSchedule schedule_ = SendSchedule::saturate();  // 发送计划
+    LatencyHistogram send_latency_;            // 开环模式下从预定时间到发布成功的延迟
+    size_t batch_size_ = DEFAULT_BATCH_SIZE;   // 批量生成器每次可填充的最大条数
+    OverflowPolicy overflow_policy_ = OverflowPolicy::Block;  // 队列满时的溢出策略
+    size_t staging_capacity_ = 0;              // Block策略下的本地暂存容量，0表示只保留当前一条
+    std::vector<T> staging_;                   // 本地暂存环形缓冲区，停止后保留，再次启动时先补发
+    size_t staging_head_ = 0;                  // 最早暂存消息的位置
+    size_t staging_count_ = 0;                 // 暂存消息数
+    std::vector<T> pending_;                   // 停止时尚未写入队列的消息(按生成顺序)，再次启动时最先发布
+    std::unique_ptr<SpillFile<T>> spill_;      // Spill策略下的溢出文件
 
 #if QUEUE_PRODUCER_PERF_STATS
     ProducerStats stats_;  // 性能统计
 #endif
 
+    /**
+     * @brief 调用数据生成器
+     * @param intended 预定发送时间，只传给接受该参数的生成器
+     */
+    T generate(uint64_t intended) {
+        if constexpr (TIMED_GENERATOR) {
+            return data_generator_(intended);
+        } else {
+            (void)intended;
+            return data_generator_();
+        }
+    }
+
+    /**
+     * @brief 调用队列满回调，可判空的回调类型(std::function、函数指针)为空时跳过
+     */
+    void notify_queue_full() {
+        if constexpr (std::is_constructible_v<bool, const OnQueueFull&>) {
+            if (!on_queue_full_) {
+                return;
+            }
+        }
+        on_queue_full_();
+    }
+
+    /**
+     * @brief 执行一轮回退等待，时长按队列腾出空间的间隔自适应(见 AdaptiveBackoff)
+     */
+    void backoff_pause(AdaptiveBackoff& backoff) {
+        [[maybe_unused]] const uint64_t ticks = backoff.pause();
+#if QUEUE_PRODUCER_PERF_STATS
+        stats_.record_backoff(ticks);
+        stats_.record_arrival_interval(backoff.interval_ticks());
+#endif
+    }
+
+    /**
+     * @brief 记录写入进展，结束回退
+     * @param count 本次写入的消息数
+     */
+    void backoff_progress(AdaptiveBackoff& backoff, size_t count = 1) {
+        [[maybe_unused]] const uint64_t wake_ticks = backoff.on_progress(count);
+#if QUEUE_PRODUCER_PERF_STATS
+        if (wake_ticks > 0) {
+            stats_.record_wake(wake_ticks);
+        }
+#endif
+    }
+
+    /**
+     * @brief 队列满时按溢出策略处理一条未能写入的消息
+     * @param data 未能写入的消息
+     * @return 消息已处理完(丢弃或强制写入)返回true；Block策略下返回false，由调用方保留重试
+     */
+    bool resolve_overflow(T& data) {
+        switch (overflow_policy_) {
+            case OverflowPolicy::Block:
+            case OverflowPolicy::Spill:
+                return false;
+            case OverflowPolicy::DropNewest:
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_.record_dropped_newest();
+#endif
+                return true;
+            case OverflowPolicy::DropOldest: {
+                const size_t evicted = queue_.push_evict_oldest(std::move(data));
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_.record_dropped_oldest(evicted);
+#else
+                (void)evicted;
+#endif
+                return true;
+            }
+            case OverflowPolicy::OverwriteLatest: {
+                const bool replaced = queue_.push_overwrite_latest(std::move(data));
+#if QUEUE_PRODUCER_PERF_STATS
+                if (replaced) {
+                    stats_.record_overwritten();
+                }
+#else
+                (void)replaced;
+#endif
+                return true;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 写入一条消息，队列满时按溢出策略处理
+     * @param data 待写入的消息
+     * @param backoff 回退状态，写入成功时结束回退
+     * @param was_full 上次是否队列满，第一次遇到队列满时调用回调
+     * @return 发布结果；Stopped 时 data 原样保留，调用方应放入 pending_，不能丢弃
+     *
+     * Block策略下会保留消息一直重试到写入成功或生产者停止；
+     * DropNewest策略下丢弃前会先回退，避免队列满时生成器空转；
+     * Spill策略下写入溢出文件同样算作 Published。
+     */
+    PublishResult publish(T& data, AdaptiveBackoff& backoff, bool& was_full) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (overflow_policy_ == OverflowPolicy::Spill && spill_) {
+                return publish_spilling(data, backoff, was_full);
+            }
+        }
+        while (true) {
+            if (queue_.try_push(data)) {
+                backoff_progress(backoff);
+                was_full = false;
+                return PublishResult::Published;
+            }
+
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_.record_queue_full();
+#endif
+            const bool forced = overflow_policy_ == OverflowPolicy::DropOldest ||
+                                overflow_policy_ == OverflowPolicy::OverwriteLatest;
+            if (!was_full) {
+                // 第一次遇到队列满，调用回调函数
+                notify_queue_full();
+                was_full = true;
+            } else if (!forced) {
+                backoff_pause(backoff);
+            }
+
+            if (resolve_overflow(data)) {
+                return forced ? PublishResult::Published : PublishResult::Dropped;
+            }
+            if (!running_.load(std::memory_order_relaxed)) {
+                return PublishResult::Stopped;
+            }
+        }
+    }
+
+    /**
+     * @brief 按顺序发布上次停止时保留的消息
+     * @return 全部发布完返回true；期间生产者再次停止时返回false，未发布的部分继续保留
+     */
+    bool publish_pending(AdaptiveBackoff& backoff, bool& was_full) {
+        size_t done = 0;
+        [[maybe_unused]] size_t published = 0;
+        for (; done < pending_.size(); ++done) {
+            const PublishResult result = publish(pending_[done], backoff, was_full);
+            if (result == PublishResult::Stopped) {
+                break;
+            }
+            if (result == PublishResult::Published) {
+                published++;
+            }
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(done));
+#if QUEUE_PRODUCER_PERF_STATS
+        if (published > 0) {
+            stats_.record_resumed(published);
+        }
+#endif
+        return pending_.empty();
+    }
+
+    /**
+     * @brief 按顺序把溢出文件中的消息补回队列，直到文件清空或队列再次满
+     * @return 本次补回的条数
+     */
+    size_t restore_spilled() {
+        size_t restored = 0;
+        while (!spill_->empty()) {
+            T data = spill_->front();
+            if (!queue_.try_push(data)) {
+                break;
+            }
+            spill_->pop_front();
+            restored++;
+        }
+#if QUEUE_PRODUCER_PERF_STATS
+        if (restored > 0) {
+            stats_.record_restored(restored);
+        }
+#endif
+        return restored;
+    }
+
+    /**
+     * @brief 每轮生产循环开头调用: 溢出文件中有积压时先补回队列
+     *
+     * 不能只在发布新消息时补回，否则生成器暂时没有数据(批量生成器返回0、开环模式等待预定时间)期间，
+     * 队列已经腾出空间，积压的消息却一直留在文件里。
+     */
+    void restore_spill_backlog() {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (spill_pending()) {
+                restore_spilled();
+            }
+        }
+    }
+
+    /**
+     * @brief Spill策略下写入一条消息
+     * @return 写入队列或溢出文件返回 Published；溢出文件也满时生产者停止返回 Stopped，
+     *         消息由调用方保留，不丢弃
+     *
+     * 溢出文件非空时新消息一律追加到文件末尾，先补回的总是更早的消息，
+     * 消费者看到的顺序与生成顺序一致。溢出文件满时退化为Block策略，等待补回腾出空间。
+     */
+    PublishResult publish_spilling(T& data, AdaptiveBackoff& backoff, bool& was_full) {
+        while (true) {
+            restore_spilled();
+            if (spill_->empty() && queue_.try_push(data)) {
+                backoff_progress(backoff);
+                was_full = false;
+                return PublishResult::Published;
+            }
+
+            if (!was_full) {
+                // 第一次遇到队列满，调用回调函数
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_.record_queue_full();
+#endif
+                notify_queue_full();
+                was_full = true;
+            }
+            if (spill_->push(data)) {
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_.record_spilled(spill_->size());
+#endif
+                return PublishResult::Published;
+            }
+
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_.record_spill_full();
+#endif
+            backoff_pause(backoff);
+            if (!running_.load(std::memory_order_relaxed)) {
+                return PublishResult::Stopped;
+            }
+        }
+    }
+
     /**
      * @brief 生产者线程主函数
      */
     void produce() {
-        unsigned int backoff = 1;    // 初始回退值
+        if constexpr (BATCH_GENERATOR) {
+            produce_batches();
+            return;
+        } else {
+            if (schedule_.is_open_loop()) {
+                produce_scheduled();
+                return;
+            }
+            produce_single();
+        }
+    }
+
+    /**
+     * @brief 逐条生成并发布
+     *
+     * Block策略下队列满时保留当前消息重试，不会再调用生成器，
+     * 因此既不浪费生成器的CPU，也不会打断消息序列。
+     * 重试期间被停止时这条消息保留在 pending_ 中，再次启动后最先发布。
+     */
+    void produce_single() {
+        if (overflow_policy_ == OverflowPolicy::Block && (staging_capacity_ > 0 || staging_count_ > 0)) {
+            produce_staged();
+            return;
+        }
+
+        AdaptiveBackoff backoff;     // 回退状态
         bool was_full = false;      // 上次是否队列满
+        if (!publish_pending(backoff, was_full)) {
+            return;
+        }
 
         while (running_.load(std::memory_order_relaxed)) {
 #if QUEUE_PRODUCER_PERF_STATS
@@ -120,45 +567,236 @@ private:
             stats_.record_produce_attempt();
 #endif
 
-            T data = data_generator_();  // 生成新数据
-            if (queue_.push(std::move(data))) {
+            T data = generate(TIMED_GENERATOR ? HighResolutionTimer::now() : 0);  // 生成新数据
+            const PublishResult result = publish(data, backoff, was_full);
+            if (result == PublishResult::Published) {
 #if QUEUE_PRODUCER_PERF_STATS
                 stats_.record_produce_success(start_time);
 #endif
-                backoff = 1;  // 重置回退值
-                was_full = false;
-            } else {
+            } else if (result == PublishResult::Stopped) {
+                pending_.push_back(std::move(data));
+            }
+        }
+    }
+
+    /**
+     * @brief Block策略下带本地暂存缓冲区的生产循环
+     *
+     * 队列满时新生成的消息先追加到本地暂存环形缓冲区，生成器可以继续消化突发流量；
+     * 每一轮都先按顺序补发暂存的消息，再向生成器要新数据。
+     * 只有暂存区也满了才停止调用生成器并回退等待，全程不丢消息、不乱序。
+     */
+    void produce_staged() {
+        if (staging_.size() != staging_capacity_ && staging_count_ == 0) {
+            staging_.resize(staging_capacity_);
+            staging_head_ = 0;
+        }
+        auto& staging = staging_;
+        auto& head = staging_head_;
+        auto& count = staging_count_;
+        AdaptiveBackoff backoff;     // 回退状态
+        bool was_full = false;       // 上次是否队列满
+        if (!publish_pending(backoff, was_full)) {
+            return;
+        }
+
+        while (running_.load(std::memory_order_relaxed)) {
+            // 先按顺序补发暂存的消息
+            size_t flushed = 0;
+            while (count > 0 && queue_.try_push(staging[head])) {
+                head = (head + 1) % staging.size();
+                count--;
+                flushed++;
+            }
+            if (flushed > 0) {
+                backoff_progress(backoff, flushed);
 #if QUEUE_PRODUCER_PERF_STATS
-                stats_.record_queue_full();
+                stats_.record_staging_flushed(flushed);
 #endif
-                
-                if (!was_full) {
-                    // 第一次遇到队列满，调用回调函数
-                    if (on_queue_full_) {
-                        on_queue_full_();
+            }
+
+            if (count < staging.size()) {
+#if QUEUE_PRODUCER_PERF_STATS
+                const auto start_time = HighResolutionTimer::now();
+                stats_.record_produce_attempt();
+#endif
+                T data = generate(TIMED_GENERATOR ? HighResolutionTimer::now() : 0);  // 生成新数据
+                if (count == 0 && queue_.try_push(data)) {
+                    backoff_progress(backoff);
+                    was_full = false;
+#if QUEUE_PRODUCER_PERF_STATS
+                    stats_.record_produce_success(start_time);
+#endif
+                } else {
+                    if (!was_full) {
+                        // 第一次遇到队列满，调用回调函数
+                        notify_queue_full();
+                        was_full = true;
                     }
-                    was_full = true;
+                    staging[(head + count) % staging.size()] = std::move(data);
+                    count++;
+#if QUEUE_PRODUCER_PERF_STATS
+                    // 只是进入本地暂存区，补发进队列时才计为成功
+                    stats_.record_staged(count);
+#endif
+                }
+                continue;
+            }
+
+            if (flushed == 0) {
+                // 队列满且暂存区满
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_.record_queue_full();
+#endif
+                backoff_pause(backoff);
+            }
+        }
+    }
+
+    /**
+     * @brief 溢出文件中是否还有等待补回的消息
+     */
+    bool spill_pending() const {
+        return overflow_policy_ == OverflowPolicy::Spill && spill_ && !spill_->empty();
+    }
+
+    /**
+     * @brief 批量生成并发布
+     *
+     * 生成器一次填充一批，push_bulk 一次发布尽可能多的部分。
+     * Block策略下，队列只剩部分空间时未发布的剩余部分保留在本地，
+     * 先把它们发布完才会再次调用生成器，消息不会丢失也不会乱序；
+     * 其他策略下剩余部分逐条按溢出策略处理。
+     * 停止时未发布的剩余部分移入 pending_，再次启动后最先发布。
+     */
+    void produce_batches() {
+        std::vector<T> batch(batch_size_);
+        size_t begin = 0;            // 未发布部分的起点
+        size_t end = 0;              // 未发布部分的终点
+        AdaptiveBackoff backoff;     // 回退状态
+        bool was_full = false;       // 上次是否队列满
+        if (!publish_pending(backoff, was_full)) {
+            return;
+        }
+
+        while (running_.load(std::memory_order_relaxed)) {
+#if QUEUE_PRODUCER_PERF_STATS
+            const auto start_time = HighResolutionTimer::now();
+            stats_.record_produce_attempt();
+#endif
+
+            restore_spill_backlog();
+            if (begin == end) {
+                begin = 0;
+                end = data_generator_(Span<T>(batch.data(), batch.size()));
+                if (end == 0) {
                     continue;
                 }
+            }
 
+            // 溢出文件中还有更早的消息时不能直接写入队列，交给 publish 按顺序处理
+            const size_t pushed = spill_pending()
+                ? 0 : queue_.push_bulk(Span<T>(batch.data() + begin, end - begin));
+            begin += pushed;
+            if (pushed > 0) {
 #if QUEUE_PRODUCER_PERF_STATS
-                stats_.record_backoff();
+                stats_.record_batch_success(start_time, pushed);
 #endif
+                backoff_progress(backoff, pushed);
+                was_full = false;
+                if (begin == end) {
+                    continue;
+                }
+            }
 
-                // 执行回退
-                for (unsigned int i = 0; i < backoff; ++i) {
-                    #if defined(__x86_64__)
-                        _mm_pause();
-                    #elif defined(__aarch64__)
-                        asm volatile("yield");
-                    #endif
+            if (overflow_policy_ != OverflowPolicy::Block) {
+                // 剩余部分逐条按溢出策略处理
+                size_t published = 0;
+                for (; begin < end; ++begin) {
+                    const PublishResult result = publish(batch[begin], backoff, was_full);
+                    if (result == PublishResult::Stopped) {
+                        break;
+                    }
+                    if (result == PublishResult::Published) {
+                        published++;
+                    }
                 }
-                
-                // 指数回退，但设置上限
-                if (backoff < 16384) {
-                    backoff *= 2;
+#if QUEUE_PRODUCER_PERF_STATS
+                if (published > 0) {
+                    stats_.record_batch_success(start_time, published);
                 }
+#endif
+                continue;
             }
+
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_.record_queue_full();
+#endif
+            if (!was_full) {
+                notify_queue_full();
+                was_full = true;
+                continue;
+            }
+            backoff_pause(backoff);
+        }
+
+        for (; begin < end; ++begin) {
+            pending_.push_back(std::move(batch[begin]));
+        }
+    }
+
+    /**
+     * @brief 开环模式的生产者线程主函数
+     *
+     * 每条消息都有按计划推进的预定发送时间:
+     * - 未到预定时间时自旋等待
+     * - 落后于计划时立即发送，但预定时间不会顺延
+     * - 队列满时按溢出策略处理；Block策略下保留当前消息重试，不丢弃也不重新生成
+     * 延迟从预定时间算起，因此背压期间积压的等待时间会完整体现在尾延迟中。
+     * 被丢弃的消息不计入延迟分布，只计入丢弃统计。
+     */
+    void produce_scheduled() {
+        send_latency_.reset();
+        schedule_.begin(HighResolutionTimer::now());
+        AdaptiveBackoff backoff;     // 回退状态，跨消息保留到达间隔
+        bool was_full = false;       // 上次是否队列满，跨消息保留: 一次背压期间只回调一次
+        if (!publish_pending(backoff, was_full)) {
+            return;
+        }
+
+        while (running_.load(std::memory_order_relaxed)) {
+            const uint64_t intended = schedule_.next();
+            restore_spill_backlog();
+            while (HighResolutionTimer::now() < intended) {
+                if (!running_.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                // 等待预定时间期间继续补回溢出文件中的消息
+                restore_spill_backlog();
+                #if defined(__x86_64__)
+                    _mm_pause();
+                #elif defined(__aarch64__)
+                    asm volatile("yield");
+                #endif
+            }
+
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_.record_produce_attempt();
+#endif
+            T data = generate(intended);
+
+            const PublishResult result = publish(data, backoff, was_full);
+            if (result != PublishResult::Published) {
+                if (result == PublishResult::Stopped) {
+                    pending_.push_back(std::move(data));
+                }
+                continue;
+            }
+
+            send_latency_.record(HighResolutionTimer::now() - intended);
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_.record_produce_success(intended);
+#endif
         }
     }
 
@@ -166,13 +804,13 @@ public:
     /**
      * @brief 构造函数
      * @param queue 目标队列
-     * @param data_generator 数据生成器函数
+     * @param data_generator 数据生成器
      * @param on_queue_full 队列满时的回调函数
      */
     LockFreeQueueProducer(
         NBQueue<T, Capacity>& queue,
-        std::function<T()> data_generator,
-        std::function<void()> on_queue_full = nullptr)
+        Generator data_generator,
+        OnQueueFull on_queue_full = OnQueueFull())
         : queue_(queue)
         , data_generator_(std::move(data_generator))
         , on_queue_full_(std::move(on_queue_full)) {}
@@ -186,11 +824,21 @@ public:
 
     /**
      * @brief 启动生产者
+     * @param options 线程选项(绑核、SCHED_FIFO优先级、线程名)
+     * @return 线程选项的应用结果，等线程完成设置后才返回；
+     *         已在运行时直接返回成功。设置失败时线程仍会运行，由调用方决定是否stop()
      */
-    void start() {
-        if (!running_.exchange(true)) {
-            producer_thread_ = std::thread(&LockFreeQueueProducer::produce, this);
+    ThreadSetupResult start(const ThreadOptions& options = {}) {
+        if (running_.exchange(true)) {
+            return {};
         }
+        std::promise<ThreadSetupResult> setup;
+        auto setup_result = setup.get_future();
+        producer_thread_ = std::thread([this, options, setup = std::move(setup)]() mutable {
+            setup.set_value(apply_thread_options(options));
+            produce();
+        });
+        return setup_result.get();
     }
 
     /**
@@ -204,6 +852,108 @@ public:
         }
     }
 
+    /**
+     * @brief 设置发送计划，需在start()之前调用
+     * @param schedule 发送计划，默认为闭环全速发送
+     *
+     * 生成器签名为 T(uint64_t) 时会收到每条消息的预定发送时间，
+     * 可写入消息供下游按预定时间计算端到端延迟。
+     * 开环模式下生产者统计中的耗时同样从预定时间算起。
+     * 批量生成器由数据源决定节奏，始终按闭环方式运行，忽略发送计划。
+     */
+    void set_send_schedule(SendSchedule schedule) {
+        schedule_ = std::move(schedule);
+    }
+
+    /**
+     * @brief 设置队列满时的溢出策略，需在start()之前调用
+     * @param policy 溢出策略，默认为 Block(不丢消息)
+     *
+     * 各策略丢弃/覆盖的消息数计入生产者统计。
+     */
+    void set_overflow_policy(OverflowPolicy policy) {
+        overflow_policy_ = policy;
+    }
+
+    /**
+     * @brief 设置Block策略下的本地暂存容量，需在start()之前调用
+     * @param capacity 暂存消息数上限，0表示只保留当前未发布的一条(默认)
+     *
+     * 暂存区让生成器在队列短暂满时继续消化突发数据，暂存的消息会先于新消息按顺序发布。
+     * 只对逐条生成的闭环模式生效；批量生成器本身就保留未发布的剩余部分。
+     */
+    void set_staging_capacity(size_t capacity) {
+        staging_capacity_ = capacity;
+    }
+
+    /**
+     * @brief 为Spill策略创建溢出文件，需在start()之前调用
+     * @param path 溢出文件路径，已存在时会被清空，生产者销毁时删除
+     * @param capacity 溢出文件最多可容纳的消息数，超过后退化为Block策略等待
+     * @throw std::system_error 创建或映射文件失败
+     *
+     * 队列满时消息按生成顺序追加到溢出文件，生产者每次发布前先把文件中的消息补回队列，
+     * 消费者无需任何改动即可按顺序读到全部消息。这样内存中的环形缓冲区只需按常态流量设计，
+     * 偶发的大突发由磁盘吸收，代价是突发期间的额外延迟。
+     * 未设置溢出文件时 Spill 策略与 Block 相同。T 不可平凡复制时编译失败。
+     */
+    void set_spill_file(const std::string& path, size_t capacity) {
+        static_assert(std::is_trivially_copyable_v<T>, "溢出文件按原始字节保存消息，T 必须可平凡复制");
+        spill_ = std::make_unique<SpillFile<T>>(path, capacity);
+    }
+
+    /**
+     * @brief 溢出文件中尚未补回队列的消息数，需在stop()之后读取
+     *
+     * 停止时溢出文件中的消息保留，再次start()后继续补回。
+     */
+    size_t spilled_count() const {
+        return spill_ ? spill_->size() : 0;
+    }
+
+    /**
+     * @brief 暂存区中尚未发布的消息数，需在stop()之后读取
+     *
+     * 停止时暂存的消息不会丢弃，再次start()后会先于新消息补发。
+     */
+    size_t staged_count() const {
+        return staging_count_;
+    }
+
+    /**
+     * @brief 是否保留着停止时尚未写入队列的消息，需在stop()之后读取
+     *
+     * Block/Spill 策略下队列满时停止，正在重试的消息(批量生成器为整批未发布的剩余部分)
+     * 不会丢弃，再次start()后先于新消息按顺序发布。
+     */
+    bool has_pending() const {
+        return !pending_.empty();
+    }
+
+    /**
+     * @brief 停止时保留的未发布消息数，需在stop()之后读取
+     */
+    size_t pending_count() const {
+        return pending_.size();
+    }
+
+    /**
+     * @brief 设置批量生成器每次可填充的最大条数，需在start()之前调用
+     * @param batch_size 批量大小，只对 size_t(Span<T>) 签名的生成器生效
+     */
+    void set_batch_size(size_t batch_size) {
+        batch_size_ = batch_size > 0 ? batch_size : 1;
+    }
+
+    /**
+     * @brief 开环模式下从预定时间到发布成功的延迟分布
+     *
+     * 直方图由生产者线程写入，需在stop()之后读取。
+     */
+    const LatencyHistogram& send_latency() const {
+        return send_latency_;
+    }
+
 #if QUEUE_PRODUCER_PERF_STATS
     /**
      * @brief 获取性能统计信息
@@ -219,4 +969,13 @@ public:
         stats_.reset();
     }
 #endif
-}; 
\ No newline at end of file
+};
+
+// 推导指引: 从队列和可调用对象推导出模板参数
+template<typename T, size_t Capacity, typename Generator>
+LockFreeQueueProducer(NBQueue<T, Capacity>&, Generator)
+    -> LockFreeQueueProducer<T, Capacity, Generator>;
+
+template<typename T, size_t Capacity, typename Generator, typename OnQueueFull>
+LockFreeQueueProducer(NBQueue<T, Capacity>&, Generator, OnQueueFull)
+    -> LockFreeQueueProducer<T, Capacity, Generator, OnQueueFull>;
@@ -2,8 +2,18 @@
 #include <atomic>
 #include <thread>
 #include <sstream>
+#include <future>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "timer.hpp"
+#include "backoff.hpp"
+#include "span.hpp"
+#include "thread_options.hpp"
 #include "queue.hpp"
+#include "sequence_barrier.hpp"
+
+class ReaderExecutor;
 
 /**
  * @brief 队列读取器性能统计类
@@ -20,9 +30,47 @@ public:
         update_max_min_time(duration);
     }
 
+    void record_successful_batch(uint64_t start_time, size_t count) {
+        const auto end_time = HighResolutionTimer::now();
+        const auto duration = end_time - start_time;
+
+        successful_reads += count;
+        batch_count++;
+        total_ticks += duration;
+        update_max_min_time(duration);
+    }
+
+    void record_gap(uint64_t lost) {
+        gap_count++;
+        lost_messages += lost;
+    }
+
+    void record_lag(uint64_t lag) {
+        current_lag = lag;
+        uint64_t current_max = max_lag.load();
+        while (lag > current_max &&
+               !max_lag.compare_exchange_weak(current_max, lag));
+    }
+
+    void record_barrier_wait() {
+        barrier_waits++;
+    }
+
     void record_empty_read() {
         empty_reads++;
+    }
+
+    void record_backoff(uint64_t ticks) {
         backoff_count++;
+        backoff.record_pause(ticks);
+    }
+
+    void record_wake(uint64_t ticks) {
+        backoff.record_wake(ticks);
+    }
+
+    void record_arrival_interval(uint64_t ticks) {
+        backoff.record_interval(ticks);
     }
 
     void increment_total_reads() {
@@ -41,6 +89,16 @@ public:
         ss << "成功读取次数: " << success << "\n";
         ss << "空读取次数: " << empty << "\n";
         ss << "回退次数: " << backoff_count.load() << "\n";
+        ss << backoff.get_stats();
+        ss << "等待上游次数: " << barrier_waits.load() << "\n";
+        const auto batches = batch_count.load();
+        if (batches > 0) {
+            ss << "批量回调次数: " << batches << "\n";
+            ss << "平均批量大小: " << static_cast<double>(success) / batches << "\n";
+        }
+        ss << "落后消息数: " << current_lag.load() << " (最大 " << max_lag.load() << ")\n";
+        ss << "漏读次数: " << gap_count.load() << "\n";
+        ss << "漏读消息数: " << lost_messages.load() << "\n";
         
         if (success > 0) {
             const auto avg_ns = HighResolutionTimer::to_ns(total_ticks.load() / success);
@@ -59,20 +117,34 @@ public:
         total_reads = 0;
         successful_reads = 0;
         empty_reads = 0;
+        batch_count = 0;
+        barrier_waits = 0;
+        gap_count = 0;
+        lost_messages = 0;
+        current_lag = 0;
+        max_lag = 0;
         total_ticks = 0;
         max_ticks = 0;
         min_ticks = UINT64_MAX;
         backoff_count = 0;
+        backoff.reset();
     }
 
 private:
     std::atomic<size_t> total_reads{0};
     std::atomic<size_t> successful_reads{0};
     std::atomic<size_t> empty_reads{0};
+    std::atomic<size_t> batch_count{0};
+    std::atomic<size_t> barrier_waits{0};       // 消息已写入但上游阶段还没处理完的次数
+    std::atomic<size_t> gap_count{0};           // 检测到漏读的次数
+    std::atomic<uint64_t> lost_messages{0};     // 漏读的消息总数
+    std::atomic<uint64_t> current_lag{0};       // 最近一次读取后落后于写入位置的消息数
+    std::atomic<uint64_t> max_lag{0};           // 最大落后消息数
     std::atomic<uint64_t> total_ticks{0};
     std::atomic<uint64_t> max_ticks{0};
     std::atomic<uint64_t> min_ticks{UINT64_MAX};
     std::atomic<size_t> backoff_count{0};
+    BackoffStats backoff;                       // 回退时长、唤醒延迟和消息到达间隔
 
     void update_max_min_time(uint64_t duration) {
         uint64_t current_max = max_ticks.load();
@@ -86,6 +158,14 @@ private:
 };
 #endif 
 
+/**
+ * @brief 读取器落后太多、漏掉消息后的处理方式
+ */
+enum class GapPolicy {
+    ResumeOldest,   // 从队列中最早仍在的消息继续，只丢失已被移除的部分
+    JumpToNewest,   // 跳到最新写入位置，放弃积压，尽快追上实时数据
+};
+
 /**
  * @brief 高性能无锁队列读取器，使用CRTP模式
  * @tparam Derived 派生类类型
@@ -97,41 +177,232 @@ private:
  * 2. 使用自旋等待和回退策略
  * 3. 通过CRTP实现零开销的数据处理回调
  * 4. 提供详细的性能统计
+ *
+ * 派生类实现 on_data(const T&) 逐条处理；如果实现了 on_batch(Span<const T>)，
+ * 则改为每次拿到一段连续可读的消息(最多 batch_size 条)批量处理，on_data 不再被调用。
+ * 队列槽位中保存的是指针，批量中的消息是拷贝到读取器本地缓冲区的副本。
+ *
+ * 读取器按绝对序号读取，从启动时队列中最早的消息开始。读取器要读的消息如果在读到之前
+ * 已被消费者取走或被溢出策略挤出，读取器会发现序号落在 head_sequence() 之前，
+ * 按 GapPolicy 跳到新位置，并调用派生类的 on_gap(from, to)(如果实现了)报告
+ * [from, to) 这段不会再收到的消息；派生类可以在其中从日志重放补齐(见 Journal::replay)。
+ * 漏读次数、漏读消息数和落后的消息数计入统计。
+ *
+ * 派生类实现 on_idle() 时，每次没有可读消息、回退等待之前调用一次，
+ * 用于在空闲时完成按时间触发的工作(例如 JournalReader 按时间间隔落盘)。
+ *
+ * 多阶段流水线: 读取器可以通过 depends_on() 依赖其他读取器的进度(cursor())，只处理上游都已
+ * 处理完的消息。派生类实现 on_entry(T&) 时直接在队列槽位中原地修改消息，不做拷贝，
+ * 优先于 on_batch/on_data。例如:
+ *   decode.start(); enrich.depends_on(decode.cursor()); risk.depends_on(enrich.cursor());
+ *   consumer.depends_on(risk.cursor());   // 所有阶段处理完才取走
+ *
+ * 读取器数量远多于CPU核数时，不调用 start()，改为交给 ReaderExecutor 在共享的线程池中轮询。
  */
 template<typename Derived, typename T, size_t Capacity>
 class LockFreeQueueReader {
 private:
+    friend class ReaderExecutor;
+
+    static constexpr size_t DEFAULT_BATCH_SIZE = 64;   // 批量回调的默认最大条数
+
+    // 检测派生类是否实现了 on_batch(Span<const T>)
+    template<typename D, typename = void>
+    struct has_on_batch : std::false_type {};
+    template<typename D>
+    struct has_on_batch<D, std::void_t<decltype(std::declval<D&>().on_batch(std::declval<Span<const T>>()))>>
+        : std::true_type {};
+
+    // 检测派生类是否实现了 on_entry(T&)，即原地处理队列中的消息
+    template<typename D, typename = void>
+    struct has_on_entry : std::false_type {};
+    template<typename D>
+    struct has_on_entry<D, std::void_t<decltype(std::declval<D&>().on_entry(std::declval<T&>()))>>
+        : std::true_type {};
+
+    // 检测派生类是否实现了 on_gap(uint64_t, uint64_t)
+    template<typename D, typename = void>
+    struct has_on_gap : std::false_type {};
+    template<typename D>
+    struct has_on_gap<D, std::void_t<decltype(std::declval<D&>().on_gap(uint64_t{}, uint64_t{}))>>
+        : std::true_type {};
+
+    // 检测派生类是否实现了 on_idle()
+    template<typename D, typename = void>
+    struct has_on_idle : std::false_type {};
+    template<typename D>
+    struct has_on_idle<D, std::void_t<decltype(std::declval<D&>().on_idle())>>
+        : std::true_type {};
+
     NBQueue<T, Capacity>& queue_;    // 被观察的队列
     std::atomic<bool> running_{false};         // 运行状态标志
     std::thread observer_thread_;              // 观察者线程
+    size_t batch_size_ = DEFAULT_BATCH_SIZE;   // 批量回调的最大条数
+    GapPolicy gap_policy_ = GapPolicy::ResumeOldest;  // 漏读后的处理方式
+    SequenceBarrier barrier_;                  // 依赖的上游阶段
+    SequenceCursor cursor_;                    // 本阶段的处理进度，供下游依赖
+    uint64_t current_pos_ = 0;                 // 当前读取序号
+    std::vector<T> batch_;                     // 批量回调缓冲区
+    uint64_t start_time_ = 0;                  // 开始读取的时间
     
 #if QUEUE_READER_PERF_STATS
     QueueReaderStats stats_;  // 将统计信息移到单独的类中
 #endif
 
     /**
-     * @brief 观察者线程主函数
+     * @brief 从当前位置读取并处理数据
+     * @param current_pos 当前读取序号，成功时向后推进
+     * @param batch 批量回调的本地缓冲区
+     * @return 读到的消息数，0表示当前位置为空
      */
-    void observe() {
-        size_t current_pos = 0;     // 当前读取位置
-        unsigned int backoff = 1;    // 初始回退值
-        bool was_empty = false;      // 上次读取是否为空
-
+    size_t consume_available(uint64_t& current_pos, std::vector<T>& batch,
+                             [[maybe_unused]] uint64_t start_time) {
+        const uint64_t limit = barrier_.available();
+        if (current_pos >= limit) {
 #if QUEUE_READER_PERF_STATS
-        const auto start_time = HighResolutionTimer::now();
+            if (current_pos < queue_.tail_sequence()) {
+                stats_.record_barrier_wait();
+            }
 #endif
+            return 0;
+        }
+        const uint64_t available = limit - current_pos;
 
-        while (running_.load(std::memory_order_relaxed)) {
-            auto result = queue_.read_at(current_pos);
-            
+        size_t count = 0;
+        if constexpr (has_on_entry<Derived>::value) {
+            // 原地处理，每次最多 batch_size 条后发布一次进度
+            const size_t max_count = available < batch_size_ ? static_cast<size_t>(available) : batch_size_;
+            while (count < max_count &&
+                   queue_.access_sequence(current_pos + count, [this](T& value) {
+                       static_cast<Derived*>(this)->on_entry(value);
+                   })) {
+                count++;
+            }
+            if (count > 0) {
+#if QUEUE_READER_PERF_STATS
+                stats_.record_successful_batch(start_time, count);
+#endif
+            }
+        } else if constexpr (has_on_batch<Derived>::value) {
+            const size_t max_count = available < batch.size() ? static_cast<size_t>(available) : batch.size();
+            count = queue_.read_batch(current_pos, Span<T>(batch.data(), max_count));
+            if (count > 0) {
+#if QUEUE_READER_PERF_STATS
+                stats_.record_successful_batch(start_time, count);
+#endif
+                static_cast<Derived*>(this)->on_batch(Span<const T>(batch.data(), count));
+            }
+        } else {
+            auto result = queue_.read_sequence(current_pos);
             if (result.has_value()) {
 #if QUEUE_READER_PERF_STATS
                 stats_.record_successful_read(start_time);  // 使用统计类的方法
 #endif
                 static_cast<Derived*>(this)->on_data(*result);
-                
-                current_pos++;
-                backoff = 1;  // 重置回退值
+                count = 1;
+            }
+        }
+        current_pos += count;
+        if (count > 0) {
+            cursor_.publish(current_pos);
+        }
+#if QUEUE_READER_PERF_STATS
+        if (count > 0) {
+            const uint64_t tail = queue_.tail_sequence();
+            stats_.record_lag(tail > current_pos ? tail - current_pos : 0);
+        }
+#endif
+        return count;
+    }
+
+    /**
+     * @brief 检查当前位置的消息是否已被移除，是则按 GapPolicy 跳过
+     * @param current_pos 当前读取序号，发生漏读时被移到新位置
+     * @return 发生漏读返回true
+     */
+    bool skip_gap(uint64_t& current_pos) {
+        const uint64_t head = queue_.head_sequence();
+        if (current_pos >= head) {
+            return false;
+        }
+        uint64_t resume = head;
+        if (gap_policy_ == GapPolicy::JumpToNewest) {
+            const uint64_t tail = queue_.tail_sequence();
+            resume = tail > head ? tail : head;
+        }
+#if QUEUE_READER_PERF_STATS
+        stats_.record_gap(resume - current_pos);
+#endif
+        if constexpr (has_on_gap<Derived>::value) {
+            static_cast<Derived*>(this)->on_gap(current_pos, resume);
+        }
+        current_pos = resume;
+        cursor_.publish(current_pos);
+        return true;
+    }
+
+    /**
+     * @brief 从队列中最早的消息开始读取，初始化读取位置和批量缓冲区
+     */
+    void begin_reading() {
+        current_pos_ = queue_.head_sequence();
+        cursor_.publish(current_pos_);
+        if constexpr (has_on_batch<Derived>::value && !has_on_entry<Derived>::value) {
+            batch_.resize(batch_size_);
+        }
+#if QUEUE_READER_PERF_STATS
+        start_time_ = HighResolutionTimer::now();
+#endif
+    }
+
+    /**
+     * @brief 由 ReaderExecutor 调用: 处理当前可读的消息，最多约 budget 条后让出
+     * @param budget 本轮最多处理的消息数，批量模式下最后一批可能略超出
+     * @return 处理的消息数，0表示没有可读消息(漏读跳过不计入)
+     */
+    size_t poll(size_t budget) {
+        size_t processed = 0;
+        while (processed < budget) {
+            const size_t count = consume_available(current_pos_, batch_, start_time_);
+            if (count == 0 && !skip_gap(current_pos_)) {
+                break;
+            }
+            processed += count;
+        }
+        if (processed == 0) {
+#if QUEUE_READER_PERF_STATS
+            stats_.record_empty_read();
+#endif
+            if constexpr (has_on_idle<Derived>::value) {
+                static_cast<Derived*>(this)->on_idle();
+            }
+        }
+        return processed;
+    }
+
+    /**
+     * @brief 被观察队列的地址，ReaderExecutor 据此把同一队列的读取器排在一起
+     */
+    const void* queue_address() const {
+        return &queue_;
+    }
+
+    /**
+     * @brief 观察者线程主函数
+     */
+    void observe() {
+        AdaptiveBackoff backoff;     // 回退状态
+        bool was_empty = false;      // 上次读取是否为空
+
+        while (running_.load(std::memory_order_relaxed)) {
+            const size_t count = consume_available(current_pos_, batch_, start_time_);
+            if (count > 0 || skip_gap(current_pos_)) {
+                [[maybe_unused]] const uint64_t wake_ticks = backoff.on_progress(count);
+#if QUEUE_READER_PERF_STATS
+                if (wake_ticks > 0) {
+                    stats_.record_wake(wake_ticks);
+                }
+#endif
                 was_empty = false;
             } else {
 #if QUEUE_READER_PERF_STATS
@@ -147,19 +418,16 @@ private:
 #if QUEUE_READER_PERF_STATS
                 stats_.increment_total_reads();
 #endif
-
-                for (unsigned int i = 0; i < backoff; ++i) {
-                    #if defined(__x86_64__)
-                        _mm_pause();
-                    #elif defined(__aarch64__)
-                        asm volatile("yield");
-                    #endif
-                }
-                
-                // 指数回退，但设置上限
-                if (backoff < 16384) {
-                    backoff *= 2;
+                if constexpr (has_on_idle<Derived>::value) {
+                    static_cast<Derived*>(this)->on_idle();
                 }
+
+                // 按消息到达间隔自适应的指数回退
+                [[maybe_unused]] const uint64_t pause_ticks = backoff.pause();
+#if QUEUE_READER_PERF_STATS
+                stats_.record_backoff(pause_ticks);
+                stats_.record_arrival_interval(backoff.interval_ticks());
+#endif
             }
         }
     }
@@ -182,11 +450,25 @@ public:
 
     /**
      * @brief 启动观察者
+     * @param options 线程选项(绑核、SCHED_FIFO优先级、线程名)
+     * @return 线程选项的应用结果，等线程完成设置后才返回；
+     *         已在运行时直接返回成功。设置失败时线程仍会运行，由调用方决定是否stop()
+     *
+     * 读取位置在返回前就已确定: start() 之后写入的消息一定会被读到(或作为漏读报告)。
      */
-    void start() {
-        if (!running_.exchange(true)) {
-            observer_thread_ = std::thread(&LockFreeQueueReader::observe, this);
+    ThreadSetupResult start(const ThreadOptions& options = {}) {
+        if (running_.exchange(true)) {
+            return {};
         }
+        // 在调用线程上确定起始位置，线程创建保证观察者线程看到这些状态
+        begin_reading();
+        std::promise<ThreadSetupResult> setup;
+        auto setup_result = setup.get_future();
+        observer_thread_ = std::thread([this, options, setup = std::move(setup)]() mutable {
+            setup.set_value(apply_thread_options(options));
+            observe();
+        });
+        return setup_result.get();
     }
 
     /**
@@ -200,6 +482,40 @@ public:
         }
     }
 
+    /**
+     * @brief 依赖上游阶段: 只处理上游已处理完的消息，需在start()之前调用
+     * @param upstream 上游阶段的进度，例如另一个读取器的 cursor()，需比本读取器存活更久
+     */
+    void depends_on(const SequenceCursor& upstream) {
+        barrier_.add(upstream);
+    }
+
+    /**
+     * @brief 本读取器的处理进度: 序号小于该值的消息已处理完(或已作为漏读跳过)
+     *
+     * 启动前为0，因此依赖它的下游在它启动前不会处理任何消息。
+     * 停止后进度保持不变，下游会停在这里。
+     */
+    const SequenceCursor& cursor() const {
+        return cursor_;
+    }
+
+    /**
+     * @brief 设置漏读后的处理方式，需在start()之前调用
+     * @param policy 默认为 ResumeOldest
+     */
+    void set_gap_policy(GapPolicy policy) {
+        gap_policy_ = policy;
+    }
+
+    /**
+     * @brief 设置批量回调每次最多处理的条数，需在start()之前调用
+     * @param batch_size 最大条数，至少为1；对 on_batch 和 on_entry 生效，on_data 逐条处理不受影响
+     */
+    void set_batch_size(size_t batch_size) {
+        batch_size_ = batch_size > 0 ? batch_size : 1;
+    }
+
 #if QUEUE_READER_PERF_STATS
     /**
      * @brief 获取性能统计信息
@@ -1,6 +1,6 @@
 #include "queue.hpp"
 #include "lock_free_queue_producer.hpp"
-#include "lock_free_queue_reader.hpp"
+#include "lock_free_queue_consumer.hpp"
 #include <iostream>
 #include <vector>
 #include <thread>
@@ -17,28 +17,7 @@
     #include <arm_neon.h>
 #endif
 #include "timer.hpp"
-
-/**
- * @brief 测试用的自定义数据类型
- */
-struct TestData {
-    uint64_t timestamp;      // 时间戳
-    uint64_t sequence;       // 序列号
-    uint64_t value;         // 数值
-    uint8_t  flags[4];      // 标志位
-
-    // 构造函数
-    TestData(uint64_t seq = 0) 
-        : timestamp(0)
-        , sequence(seq)
-        , value(0)
-    {
-        flags[0] = 0;
-        flags[1] = 0;
-        flags[2] = 0;
-        flags[3] = 0;
-    }
-};
+#include "test_data.hpp"
 
 /**
  * @brief 性能测试参数
@@ -49,43 +28,6 @@ constexpr size_t NUM_PRODUCERS = 2;            // 生产者线程数
 constexpr size_t NUM_CONSUMERS = 3;            // 消费者线程数
 constexpr size_t NUM_OPERATIONS = 1000000; // 操作次数
 
-/**
- * @brief 数据生成器
- */
-class DataGenerator {
-public:
-    DataGenerator() : sequence_(0) {
-        // 初始化随机数生成器
-        std::random_device rd;
-        rng_.seed(rd());
-    }
-
-    TestData generate() {
-        TestData data(sequence_++);
-        
-        // 生成随机时间戳
-        data.timestamp = std::chrono::system_clock::now()
-            .time_since_epoch()
-            .count();
-        
-        // 生成随机值
-        data.value = value_dist_(rng_);
-        
-        // 生成随机标志位
-        for (int i = 0; i < 4; ++i) {
-            data.flags[i] = flag_dist_(rng_);
-        }
-        
-        return data;
-    }
-
-private:
-    std::atomic<uint64_t> sequence_;
-    std::mt19937_64 rng_;
-    std::uniform_int_distribution<uint64_t> value_dist_;
-    std::uniform_int_distribution<uint16_t> flag_dist_{0, 255};
-};
-
 /**
  * @brief 队列满时的回调函数
  */
@@ -117,7 +59,8 @@ void test_memory_pool() {
     auto end = HighResolutionTimer::now();
     const auto duration_ms = HighResolutionTimer::to_ms(end - start);
 
-    std::cout << "内存池: " << duration_ms << " 毫秒用于 " << NUM_OPERATIONS << " 次分配和释放。\n";
+    std::cout << "内存池: " << duration_ms << " 毫秒用于 " << NUM_OPERATIONS << " 次分配和释放"
+              << "(" << to_string(pool.page_mode()) << ", 每块 " << pool.block_size() << " 个对象)。\n";
 }
 
 /**
@@ -154,32 +97,44 @@ int main() {
     // 创建数据生成器
     DataGenerator generator;
     
-    // 创建生产者
-    std::vector<std::unique_ptr<LockFreeQueueProducer<TestData, QUEUE_CAPACITY>>> producers;
+    // 创建生产者，生成器以具体类型作为模板参数，可被内联进生产循环
+    auto generate = [&generator]() { return generator.generate(); };
+    using Producer = LockFreeQueueProducer<TestData, QUEUE_CAPACITY, decltype(generate), void (*)()>;
+    std::vector<std::unique_ptr<Producer>> producers;
     for (size_t i = 0; i < NUM_PRODUCERS; ++i) {
-        producers.emplace_back(std::make_unique<LockFreeQueueProducer<TestData, QUEUE_CAPACITY>>(
+        producers.emplace_back(std::make_unique<Producer>(
             queue,
-            [&generator]() { return generator.generate(); },
+            generate,
             on_queue_full
         ));
     }
 
     // 创建消费者
-    std::vector<std::unique_ptr<MyQueueReader<TestData, QUEUE_CAPACITY>>> consumers;
+    std::vector<std::unique_ptr<MyQueueConsumer<TestData, QUEUE_CAPACITY>>> consumers;
     for (size_t i = 0; i < NUM_CONSUMERS; ++i) {
-        consumers.emplace_back(std::make_unique<MyQueueReader<TestData, QUEUE_CAPACITY>>(queue));
+        consumers.emplace_back(std::make_unique<MyQueueConsumer<TestData, QUEUE_CAPACITY>>(queue));
     }
 
     const auto start_count = HighResolutionTimer::now();
 
     // 启动所有生产者
-    for (auto& producer : producers) {
-        producer->start();
+    for (size_t i = 0; i < producers.size(); ++i) {
+        ThreadOptions options;
+        options.name = "producer-" + std::to_string(i);
+        const auto result = producers[i]->start(options);
+        if (!result.ok()) {
+            std::cerr << options.name << ": " << result.describe();
+        }
     }
 
     // 启动所有消费者
-    for (auto& consumer : consumers) {
-        consumer->start();
+    for (size_t i = 0; i < consumers.size(); ++i) {
+        ThreadOptions options;
+        options.name = "consumer-" + std::to_string(i);
+        const auto result = consumers[i]->start(options);
+        if (!result.ok()) {
+            std::cerr << options.name << ": " << result.describe();
+        }
     }
 
     // 等待一段时间
@@ -1,30 +1,215 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <atomic>
+#include <algorithm>
+#include <initializer_list>
+#include <fstream>
 #include <iostream>
 #include <cassert>
-#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
 #include <sys/mman.h> // 引入mmap相关的头文件
+#include "numa.hpp"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;   // 大页大小(2M)
+
+/**
+ * @brief 内存块实际使用的页面类型
+ */
+enum class PoolPageMode {
+    Hugetlb,            // MAP_HUGETLB 预留的2M大页
+    TransparentHuge,    // 2M对齐的普通映射 + madvise(MADV_HUGEPAGE)，由内核合并为透明大页
+    Normal,             // 普通4K页
+};
+
+inline const char* to_string(PoolPageMode mode) {
+    switch (mode) {
+        case PoolPageMode::Hugetlb: return "HugeTLB大页";
+        case PoolPageMode::TransparentHuge: return "透明大页";
+        case PoolPageMode::Normal: return "普通页";
+    }
+    return "未知";
+}
+
+/**
+ * @brief 透明大页是否可能生效: 内核支持且 enabled 不为 never
+ */
+inline bool transparent_huge_pages_enabled() {
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string setting;
+    if (!std::getline(file, setting)) {
+        return false;
+    }
+    return setting.find("[never]") == std::string::npos;
+}
+
+/**
+ * @brief 内存池的内存块分配器: 用mmap分配固定大小的内存块，析构时统一释放
+ *
+ * 使用大页时块大小向上取整到2M，按以下顺序尝试，失败后后续的块不再尝试更高的方式:
+ * 1. MAP_HUGETLB: 需要系统预留大页(vm.nr_hugepages)，预留不足时失败
+ * 2. 2M对齐的映射 + madvise(MADV_HUGEPAGE): 需要透明大页为 always 或 madvise
+ * 3. 普通页(映射失败时最后再试一次普通映射)，使用大页时块大小仍为2M的倍数
+ * page_mode() 报告最近一个块实际使用的方式。
+ *
+ * 不是线程安全的，由使用它的内存池负责同步。
+ */
+class PoolBlockAllocator {
+public:
+    /**
+     * @param block_bytes 每个内存块的最小字节数
+     * @param numa_node 内存块绑定的NUMA节点，小于0表示不绑定
+     * @param huge_pages 是否尝试使用大页
+     */
+    PoolBlockAllocator(size_t block_bytes, int numa_node, bool huge_pages)
+        : block_bytes_(huge_pages ? round_up(block_bytes, HUGE_PAGE_SIZE) : round_up_to_page(block_bytes)),
+          numa_node_(numa_node),
+          mode_(huge_pages ? PoolPageMode::Hugetlb : PoolPageMode::Normal) {}
+
+    ~PoolBlockAllocator() {
+        for (auto block : blocks_) {
+            munmap(block, block_bytes_);
+        }
+    }
+
+    PoolBlockAllocator(const PoolBlockAllocator&) = delete;
+    PoolBlockAllocator& operator=(const PoolBlockAllocator&) = delete;
+
+    /**
+     * @brief 分配一个新的内存块
+     * @throw std::bad_alloc mmap失败
+     * @throw std::system_error 绑定NUMA节点失败
+     */
+    void* allocate() {
+        void* block = MAP_FAILED;
+        PoolPageMode mode = mode_.load(std::memory_order_relaxed);
+        if (mode == PoolPageMode::Hugetlb) {
+            block = mmap(nullptr, block_bytes_, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+            if (block == MAP_FAILED) {
+                mode = transparent_huge_pages_enabled() ? PoolPageMode::TransparentHuge : PoolPageMode::Normal;
+            }
+        }
+        if (mode == PoolPageMode::TransparentHuge) {
+            block = map_aligned(block_bytes_, HUGE_PAGE_SIZE);
+            if (block == MAP_FAILED) {
+                mode = PoolPageMode::Normal;   // 多映射的对齐余量也可能导致失败，改用普通映射重试
+            } else if (madvise(block, block_bytes_, MADV_HUGEPAGE) != 0) {
+                mode = PoolPageMode::Normal;   // 内核不支持透明大页，映射仍可作为普通页使用
+            }
+        }
+        if (mode == PoolPageMode::Normal && block == MAP_FAILED) {
+            block = mmap(nullptr, block_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+        if (block == MAP_FAILED) {
+            throw std::bad_alloc(); // 如果分配失败，抛出异常
+        }
+        if (numa_node_ >= 0) {
+            // 在首次写入之前绑定，页面直接分配在目标节点上
+            const int error = numa_bind_memory(block, block_bytes_, numa_node_);
+            if (error != 0) {
+                munmap(block, block_bytes_);
+                throw std::system_error(error, std::generic_category(), "mbind");
+            }
+        }
+        mode_.store(mode, std::memory_order_relaxed);
+        blocks_.push_back(block);
+        return block;
+    }
+
+    /**
+     * @brief 取整后每个内存块的字节数
+     */
+    size_t block_bytes() const {
+        return block_bytes_;
+    }
+
+    /**
+     * @brief 最近一个内存块实际使用的页面类型，分配第一个块之前为将要尝试的方式
+     */
+    PoolPageMode page_mode() const {
+        return mode_.load(std::memory_order_relaxed);
+    }
+
+private:
+    size_t block_bytes_;                   // 每个块的字节数
+    int numa_node_;                        // 内存块绑定的NUMA节点(-1表示不绑定)
+    std::atomic<PoolPageMode> mode_;       // 当前使用的页面类型
+    std::vector<void*> blocks_;            // 存储分配的内存块
+
+    static size_t round_up(size_t length, size_t alignment) {
+        return (length + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+     * @brief 映射按 alignment 对齐的内存: 多映射一个对齐单位，再释放首尾多余的部分
+     */
+    static void* map_aligned(size_t length, size_t alignment) {
+        const size_t mapped_length = length + alignment;
+        void* mapped = mmap(nullptr, mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            return MAP_FAILED;
+        }
+        const auto begin = reinterpret_cast<uintptr_t>(mapped);
+        const uintptr_t aligned = round_up(begin, alignment);
+        if (aligned > begin) {
+            munmap(mapped, aligned - begin);
+        }
+        const size_t tail = begin + mapped_length - (aligned + length);
+        if (tail > 0) {
+            munmap(reinterpret_cast<void*>(aligned + length), tail);
+        }
+        return reinterpret_cast<void*>(aligned);
+    }
+};
+
+/**
+ * @brief 内存块中的一个槽位: 使用中保存对象，空闲时保存链表指针
+ */
+template<typename T>
+union PoolSlot {
+    PoolSlot* next;                                // 空闲链表中的下一个槽位
+    alignas(T) unsigned char storage[sizeof(T)];   // 对象本身
+};
 
 /**
  * @brief 内存池类，用于高效管理固定类型的对象
  * @tparam T 对象类型
+ *
+ * 释放的对象串成侵入式单链表，链表指针直接保存在已释放对象的内存中，
+ * 分配和释放都只是几次指针操作，不产生额外的内存分配。
+ * 不是线程安全的，跨线程分配和释放使用 ConcurrentMemoryPool。
+ *
+ * 默认尝试大页，每个内存块取整到2M: 默认构造的内存池即使 block_size 很小也至少映射2M，
+ * 大页不可用时也是如此。对象很少、内存池很多时传 huge_pages = false，块只取整到页大小。
  */
 template<typename T>
 class MemoryPool {
 public:
-    MemoryPool(size_t block_size = 1024) 
-        : block_size_(block_size), current_block_(nullptr), current_index_(0) {
+    /**
+     * @param block_size 每个内存块至少容纳的对象数，按页大小取整后可能更多
+     * @param numa_node 内存块绑定的NUMA节点，小于0表示不绑定
+     * @param huge_pages 是否尝试使用大页(见 PoolBlockAllocator)
+     */
+    MemoryPool(size_t block_size = 1024, int numa_node = -1, bool huge_pages = true)
+        : blocks_(block_size * sizeof(Slot), numa_node, huge_pages),
+          block_size_(blocks_.block_bytes() / sizeof(Slot)),
+          current_block_(nullptr), current_index_(0) {
         allocate_block();
     }
 
-    ~MemoryPool() {
-        for (auto block : blocks_) {
-            munmap(block, block_size_ * sizeof(T)); // 使用munmap释放大页内存
-        }
-    }
-
     // 禁用拷贝构造和赋值操作
     MemoryPool(const MemoryPool&) = delete;
     MemoryPool& operator=(const MemoryPool&) = delete;
@@ -34,17 +219,17 @@ public:
      * @return 指向对象的指针
      */
     T* allocate() {
-        if (!freed_objects_.empty()) {
-            // 从已释放的对象中获取一个
-            T* obj = *freed_objects_.begin();
-            freed_objects_.erase(freed_objects_.begin());
-            return new (obj) T(); // 在原位置重新构造对象
+        if (free_list_ != nullptr) {
+            // 从空闲链表头部取出一个
+            Slot* slot = free_list_;
+            free_list_ = slot->next;
+            return ::new (slot->storage) T(); // 在原位置重新构造对象
         }
-        
+
         if (current_index_ >= block_size_) {
             allocate_block();
         }
-        return new (current_block_ + current_index_++ * sizeof(T)) T();
+        return ::new (current_block_[current_index_++].storage) T();
     }
 
     /**
@@ -55,29 +240,353 @@ public:
         // 这里不实际释放内存，内存池会管理内存
         // 可以在这里实现对象的析构逻辑
         obj->~T();
-        
-        // 将释放的对象记录下来
-        freed_objects_.insert(obj);
+
+        // 析构后的内存用来保存链表指针，压入空闲链表头部
+        Slot* slot = reinterpret_cast<Slot*>(obj);
+        slot->next = free_list_;
+        free_list_ = slot;
+    }
+
+    /**
+     * @brief 内存块实际使用的页面类型
+     */
+    PoolPageMode page_mode() const {
+        return blocks_.page_mode();
+    }
+
+    /**
+     * @brief 取整后每个内存块容纳的对象数
+     */
+    size_t block_size() const {
+        return block_size_;
     }
 
 private:
+    using Slot = PoolSlot<T>;
+
+    PoolBlockAllocator blocks_;        // 存储分配的内存块
     size_t block_size_;                // 每个块的大小
-    std::vector<void*> blocks_;        // 存储分配的内存块
-    char* current_block_;              // 当前块的指针
+    Slot* current_block_;              // 当前块的指针
     size_t current_index_;             // 当前块中的索引
-    std::unordered_set<T*> freed_objects_; // 存储已释放的对象指针
+    Slot* free_list_ = nullptr;        // 空闲链表头，已释放的槽位
 
     /**
-     * @brief 分配一个新的内存块，使用大页技术
+     * @brief 分配一个新的内存块
      */
     void allocate_block() {
-        // 使用mmap分配大页内存
-        current_block_ = static_cast<char*>(mmap(nullptr, block_size_ * sizeof(T), 
-            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
-        if (current_block_ == MAP_FAILED) {
-            throw std::bad_alloc(); // 如果分配失败，抛出异常
-        }
-        blocks_.push_back(current_block_);
+        current_block_ = static_cast<Slot*>(blocks_.allocate());
         current_index_ = 0;
     }
-}; 
\ No newline at end of file
+};
+
+/**
+ * @brief 为每个 ConcurrentMemoryPool 分配唯一编号，线程缓存按编号而不是地址识别内存池
+ */
+inline uint64_t next_memory_pool_id() {
+    static std::atomic<uint64_t> next_id{1};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 线程安全的内存池，可以在一个线程分配、另一个线程释放
+ * @tparam T 对象类型
+ *
+ * 采用弹匣(magazine)结构:
+ * - 每个线程有两个弹匣(当前和备用)，各保存最多 MAGAZINE_SIZE 个空闲对象；
+ *   分配和释放通常只在当前弹匣上压栈出栈，不做任何原子操作，与 MemoryPool 的开销相当
+ * - 当前弹匣空(分配)或满(释放)时先与备用弹匣交换，两个都不合适时才与全局仓库整匣交换:
+ *   仓库是两个无锁栈，分别存放装有对象的弹匣和空弹匣，每 MAGAZINE_SIZE 次操作最多访问一次
+ * - 仓库中也没有装有对象的弹匣时，加锁从内存块中一次切出一整匣新对象
+ * 生产者分配、消费者释放时，对象以整匣为单位经仓库从消费者流回生产者。
+ *
+ * 与 MemoryPool 一样，默认尝试大页时每个内存块至少2M。
+ *
+ * 线程退出时其弹匣中的对象留在该线程的缓存中，直到内存池销毁；
+ * 短生命周期的线程退出前可以调用 flush_thread_cache() 把对象还给仓库。
+ *
+ * 让 NBQueue 的消息节点使用内存池，可以在消息类型中重载 operator new/delete:
+ *   struct Order {
+ *       static ConcurrentMemoryPool<Order>& pool();
+ *       static void* operator new(size_t) { return pool().allocate_storage(); }
+ *       static void operator delete(void* p) { pool().deallocate_storage(p); }
+ *   };
+ */
+template<typename T>
+class ConcurrentMemoryPool {
+public:
+    static constexpr size_t MAGAZINE_SIZE = 64;           // 每个弹匣容纳的对象数
+    static constexpr size_t MAGAZINES_PER_CHUNK = 256;    // 弹匣按组分配，每组的弹匣数
+    static constexpr size_t MAX_MAGAZINE_CHUNKS = 4096;   // 弹匣组数上限
+
+    /**
+     * @param block_size 每个内存块至少容纳的对象数，至少为 MAGAZINE_SIZE，按页大小取整后可能更多
+     * @param numa_node 内存块绑定的NUMA节点，小于0表示不绑定
+     * @param huge_pages 是否尝试使用大页(见 PoolBlockAllocator)
+     */
+    ConcurrentMemoryPool(size_t block_size = 1024, int numa_node = -1, bool huge_pages = true)
+        : blocks_(std::max(block_size, MAGAZINE_SIZE) * sizeof(Slot), numa_node, huge_pages),
+          block_size_(blocks_.block_bytes() / sizeof(Slot)),
+          current_block_(static_cast<Slot*>(blocks_.allocate())),
+          chunks_(new std::atomic<Magazine*>[MAX_MAGAZINE_CHUNKS]()),
+          id_(next_memory_pool_id()) {}
+
+    ~ConcurrentMemoryPool() {
+        for (size_t i = 0; i < MAX_MAGAZINE_CHUNKS; ++i) {
+            delete[] chunks_[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    ConcurrentMemoryPool(const ConcurrentMemoryPool&) = delete;
+    ConcurrentMemoryPool& operator=(const ConcurrentMemoryPool&) = delete;
+
+    /**
+     * @brief 从内存池中分配一个对象
+     * @return 指向对象的指针
+     */
+    T* allocate() {
+        return ::new (allocate_storage()) T();   // 全局的定位new，消息类型可能重载了 operator new
+    }
+
+    /**
+     * @brief 释放对象，可以在与分配不同的线程中调用
+     * @param obj 指向要释放的对象的指针
+     */
+    void deallocate(T* obj) {
+        obj->~T();
+        deallocate_storage(obj);
+    }
+
+    /**
+     * @brief 分配一个对象大小的未初始化内存，供 operator new 使用
+     */
+    void* allocate_storage() {
+        ThreadCache& cache = thread_cache();
+        Magazine* loaded = cache.loaded;
+        if (loaded->count == 0) {
+            loaded = reload(cache);
+        }
+        return loaded->slots[--loaded->count];
+    }
+
+    /**
+     * @brief 归还 allocate_storage() 分配的内存，供 operator delete 使用
+     */
+    void deallocate_storage(void* ptr) {
+        ThreadCache& cache = thread_cache();
+        Magazine* loaded = cache.loaded;
+        if (loaded->count == MAGAZINE_SIZE) {
+            loaded = unload(cache);
+        }
+        loaded->slots[loaded->count++] = static_cast<Slot*>(ptr);
+    }
+
+    /**
+     * @brief 把当前线程缓存中的对象还给全局仓库，供其他线程使用
+     */
+    void flush_thread_cache() {
+        ThreadCache& cache = thread_cache();
+        for (Magazine** magazine : {&cache.loaded, &cache.previous}) {
+            if ((*magazine)->count > 0) {
+                push(full_, *magazine);
+                *magazine = take_empty();
+            }
+        }
+    }
+
+    /**
+     * @brief 内存块实际使用的页面类型
+     */
+    PoolPageMode page_mode() const {
+        return blocks_.page_mode();
+    }
+
+    /**
+     * @brief 取整后每个内存块容纳的对象数
+     */
+    size_t block_size() const {
+        return block_size_;
+    }
+
+private:
+    using Slot = PoolSlot<T>;
+
+    /**
+     * @brief 弹匣: 一组空闲对象的指针，作为整体在线程缓存和仓库之间交换
+     */
+    struct Magazine {
+        size_t count = 0;                      // 装有的对象数
+        uint32_t index = 0;                    // 弹匣编号，仓库的无锁栈按编号链接
+        std::atomic<uint32_t> next{0};         // 仓库栈中下一个弹匣的编号+1，0表示栈底
+        Slot* slots[MAGAZINE_SIZE];            // 空闲对象
+    };
+
+    /**
+     * @brief 一个线程在本内存池中的缓存
+     */
+    struct ThreadCache {
+        Magazine* loaded = nullptr;            // 当前弹匣
+        Magazine* previous = nullptr;          // 备用弹匣，总是满的或空的
+    };
+
+    /**
+     * @brief 线程最近使用的内存池及其缓存
+     */
+    struct CacheRef {
+        uint64_t pool_id = 0;
+        ThreadCache* cache = nullptr;
+    };
+
+    PoolBlockAllocator blocks_;                        // 存储分配的内存块，受 mutex_ 保护
+    size_t block_size_;                                // 每个块的大小
+    Slot* current_block_;                              // 当前块的指针
+    size_t current_index_ = 0;                         // 当前块中的索引
+    std::unique_ptr<std::atomic<Magazine*>[]> chunks_; // 弹匣组，按编号查找弹匣
+    uint32_t magazine_count_ = 0;                      // 已创建的弹匣数，受 mutex_ 保护
+    std::vector<std::unique_ptr<ThreadCache>> caches_; // 所有线程的缓存，受 mutex_ 保护
+    std::mutex mutex_;                                 // 切分内存块、创建弹匣和线程缓存
+    uint64_t id_;                                      // 内存池编号
+    alignas(64) std::atomic<uint64_t> full_{0};        // 装有对象的弹匣栈: 高32位标签，低32位栈顶编号+1
+    alignas(64) std::atomic<uint64_t> empty_{0};       // 空弹匣栈，格式同上
+
+    /**
+     * @brief 当前线程在本内存池中的缓存，常见情况下只比较一次编号
+     */
+    ThreadCache& thread_cache() {
+        static thread_local CacheRef last;
+        if (last.pool_id != id_) {
+            last = find_thread_cache();
+        }
+        return *last.cache;
+    }
+
+    /**
+     * @brief 线程交替使用多个内存池时查找或创建缓存
+     */
+    CacheRef find_thread_cache() {
+        static thread_local std::vector<CacheRef> refs;
+        for (const auto& ref : refs) {
+            if (ref.pool_id == id_) {
+                return ref;
+            }
+        }
+        auto cache = std::make_unique<ThreadCache>();
+        cache->loaded = new_magazine();
+        cache->previous = new_magazine();
+        CacheRef ref{id_, cache.get()};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            caches_.push_back(std::move(cache));
+        }
+        refs.push_back(ref);
+        return ref;
+    }
+
+    /**
+     * @brief 当前弹匣为空时换入一个装有对象的弹匣
+     */
+    Magazine* reload(ThreadCache& cache) {
+        if (cache.previous->count > 0) {
+            std::swap(cache.loaded, cache.previous);
+            return cache.loaded;
+        }
+        if (Magazine* full = pop(full_)) {
+            push(empty_, cache.previous);
+            cache.previous = cache.loaded;
+            cache.loaded = full;
+            return full;
+        }
+        refill(*cache.loaded);
+        return cache.loaded;
+    }
+
+    /**
+     * @brief 当前弹匣已满时换入一个空弹匣
+     */
+    Magazine* unload(ThreadCache& cache) {
+        if (cache.previous->count == 0) {
+            std::swap(cache.loaded, cache.previous);
+            return cache.loaded;
+        }
+        push(full_, cache.previous);
+        cache.previous = cache.loaded;
+        cache.loaded = take_empty();
+        return cache.loaded;
+    }
+
+    /**
+     * @brief 从内存块中切出一整匣新对象，地址小的先分配出去
+     */
+    void refill(Magazine& magazine) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (magazine.count < MAGAZINE_SIZE) {
+            if (current_index_ >= block_size_) {
+                current_block_ = static_cast<Slot*>(blocks_.allocate());
+                current_index_ = 0;
+            }
+            magazine.slots[magazine.count++] = &current_block_[current_index_++];
+        }
+        std::reverse(magazine.slots, magazine.slots + magazine.count);
+    }
+
+    Magazine* take_empty() {
+        if (Magazine* empty = pop(empty_)) {
+            return empty;
+        }
+        return new_magazine();
+    }
+
+    /**
+     * @brief 创建一个空弹匣，弹匣创建后直到内存池销毁都不会释放
+     * @throw std::bad_alloc 弹匣数超过上限
+     */
+    Magazine* new_magazine() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t chunk = magazine_count_ / MAGAZINES_PER_CHUNK;
+        if (chunk >= MAX_MAGAZINE_CHUNKS) {
+            throw std::bad_alloc();
+        }
+        if (magazine_count_ % MAGAZINES_PER_CHUNK == 0) {
+            chunks_[chunk].store(new Magazine[MAGAZINES_PER_CHUNK], std::memory_order_release);
+        }
+        Magazine* magazine = &chunks_[chunk].load(std::memory_order_relaxed)[magazine_count_ % MAGAZINES_PER_CHUNK];
+        magazine->index = magazine_count_++;
+        return magazine;
+    }
+
+    Magazine* magazine_at(uint32_t index) const {
+        return &chunks_[index / MAGAZINES_PER_CHUNK].load(std::memory_order_acquire)[index % MAGAZINES_PER_CHUNK];
+    }
+
+    /**
+     * @brief 压入仓库的无锁栈，栈顶带标签防止ABA
+     */
+    void push(std::atomic<uint64_t>& head, Magazine* magazine) {
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do {
+            magazine->next.store(static_cast<uint32_t>(old_head), std::memory_order_relaxed);
+            new_head = (((old_head >> 32) + 1) << 32) | (magazine->index + 1);
+        } while (!head.compare_exchange_weak(old_head, new_head,
+                                             std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief 从仓库的无锁栈弹出，栈为空时返回nullptr
+     */
+    Magazine* pop(std::atomic<uint64_t>& head) {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        for (;;) {
+            const auto top = static_cast<uint32_t>(old_head);
+            if (top == 0) {
+                return nullptr;
+            }
+            Magazine* magazine = magazine_at(top - 1);
+            const uint64_t new_head = (((old_head >> 32) + 1) << 32) |
+                                      magazine->next.load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old_head, new_head,
+                                           std::memory_order_acquire, std::memory_order_acquire)) {
+                return magazine;
+            }
+        }
+    }
+};
@@ -0,0 +1,188 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "cpu_topology.hpp"
+#include "thread_options.hpp"
+
+/**
+ * @brief NUMA内存放置工具
+ *
+ * 直接使用 mbind 系统调用，不依赖 libnuma。提供两种放置方式:
+ * - make_on_numa_node: 先把内存绑定到指定节点再构造对象
+ * - make_first_touch: 在绑定到所属线程CPU的临时线程中构造对象，依赖内核的首次访问(first-touch)策略
+ *
+ * NBQueue 的环形缓冲区和 MemoryPool 对象本身都可以通过这两种方式分配；
+ * MemoryPool 的内存块通过构造参数 numa_node 单独绑定。
+ */
+
+constexpr int NUMA_MAX_NODES = 1024;   // 支持的最大NUMA节点数
+
+/**
+ * @brief 将一段内存绑定到指定NUMA节点
+ * @param addr 起始地址(需按页对齐)
+ * @param length 长度
+ * @param node NUMA节点编号
+ * @return 成功返回0，失败返回错误码
+ *
+ * 使用 MPOL_BIND 策略，已经分配的页会被迁移到该节点(MPOL_MF_MOVE)。
+ */
+inline int numa_bind_memory(void* addr, size_t length, int node) {
+    constexpr size_t BITS = 8 * sizeof(unsigned long);
+    if (node < 0 || node >= NUMA_MAX_NODES) {
+        return EINVAL;
+    }
+    unsigned long mask[NUMA_MAX_NODES / BITS] = {};
+    mask[node / BITS] |= 1UL << (node % BITS);
+    // 内核只使用 maxnode - 1 位，因此这里多传一位
+    if (syscall(SYS_mbind, addr, length, MPOL_BIND, mask,
+                static_cast<unsigned long>(NUMA_MAX_NODES + 1), MPOL_MF_MOVE) != 0) {
+        return errno;
+    }
+    return 0;
+}
+
+/**
+ * @brief 将长度向上取整到页大小
+ */
+inline size_t round_up_to_page(size_t length) {
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (length + page - 1) / page * page;
+}
+
+/**
+ * @brief 查询一组CPU共同所属的NUMA节点
+ * @param cpus CPU集合
+ * @return 所有CPU都在同一节点时返回该节点，否则返回-1
+ */
+inline int numa_node_of_cpus(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return -1;
+    }
+    CpuTopology topology;
+    const int node = topology.node_of(cpus.front());
+    for (int cpu : cpus) {
+        if (topology.node_of(cpu) != node) {
+            return -1;
+        }
+    }
+    return node;
+}
+
+/**
+ * @brief 通过mmap分配的对象的删除器: 析构后munmap
+ */
+template<typename T>
+struct NumaDeleter {
+    size_t mapped_size = 0;   // 映射长度(页对齐)
+
+    void operator()(T* obj) const {
+        obj->~T();
+        munmap(obj, mapped_size);
+    }
+};
+
+template<typename T>
+using NumaPtr = std::unique_ptr<T, NumaDeleter<T>>;
+
+/**
+ * @brief 在指定NUMA节点上构造对象
+ * @tparam T 对象类型，例如 NBQueue<TestData, 1024>
+ * @param node NUMA节点编号，小于0表示不绑定
+ * @param args 构造参数
+ * @throw std::bad_alloc mmap失败
+ * @throw std::system_error mbind失败
+ *
+ * 先绑定再构造，构造函数首次写入的页就直接分配在目标节点上。
+ */
+template<typename T, typename... Args>
+NumaPtr<T> make_on_numa_node(int node, Args&&... args) {
+    const size_t size = round_up_to_page(sizeof(T));
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    if (node >= 0) {
+        const int error = numa_bind_memory(mem, size, node);
+        if (error != 0) {
+            munmap(mem, size);
+            throw std::system_error(error, std::generic_category(), "mbind");
+        }
+    }
+    try {
+        return NumaPtr<T>(new (mem) T(std::forward<Args>(args)...), NumaDeleter<T>{size});
+    } catch (...) {
+        munmap(mem, size);
+        throw;
+    }
+}
+
+/**
+ * @brief 在所属线程的CPU上构造对象(首次访问放置)
+ * @tparam T 对象类型
+ * @param owner 所属线程的启动选项，只使用其中的CPU集合
+ * @param args 构造参数
+ * @throw std::bad_alloc mmap失败
+ *
+ * 启动一个绑定到 owner.cpus 的临时线程执行构造，内存页按默认策略落在该CPU的本地节点。
+ * 只有构造函数写过的页才会被放置，NBQueue 的构造函数会初始化整个缓冲区。
+ * 绑核失败时退化为普通分配。
+ */
+template<typename T, typename... Args>
+NumaPtr<T> make_first_touch(const ThreadOptions& owner, Args&&... args) {
+    const size_t size = round_up_to_page(sizeof(T));
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    ThreadOptions placement;
+    placement.cpus = owner.cpus;
+    T* obj = nullptr;
+    std::exception_ptr error;
+    std::thread toucher([&]() {
+        apply_thread_options(placement);
+        try {
+            obj = new (mem) T(std::forward<Args>(args)...);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    });
+    toucher.join();
+
+    if (error) {
+        munmap(mem, size);
+        std::rethrow_exception(error);
+    }
+    return NumaPtr<T>(obj, NumaDeleter<T>{size});
+}
+
+/**
+ * @brief 为一对绑核的生产者/消费者创建队列
+ * @tparam Queue 队列类型
+ * @param producer 生产者线程选项
+ * @param consumer 消费者线程选项
+ * @param args 构造参数
+ *
+ * 默认放在这对线程所在的节点上；两者不在同一节点时放在消费者所在节点
+ * (消费者持续轮询队列，远端读的代价更高)。都未绑核时不做绑定。
+ */
+template<typename Queue, typename... Args>
+NumaPtr<Queue> make_queue_for_pair(const ThreadOptions& producer, const ThreadOptions& consumer,
+                                   Args&&... args) {
+    int node = numa_node_of_cpus(consumer.cpus);
+    if (node < 0) {
+        node = numa_node_of_cpus(producer.cpus);
+    }
+    return make_on_numa_node<Queue>(node, std::forward<Args>(args)...);
+}
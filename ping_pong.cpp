@@ -0,0 +1,200 @@
+#include "queue.hpp"
+#include "cpu_topology.hpp"
+#include "thread_options.hpp"
+#include "numa.hpp"
+#include "latency_histogram.hpp"
+#include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#if defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+#include "timer.hpp"
+#include "test_data.hpp"
+
+/**
+ * @brief 往返延迟测试参数
+ */
+constexpr size_t PING_QUEUE_CAPACITY = 64;          // 队列容量(同一时刻只有一条消息在途)
+constexpr size_t DEFAULT_ITERATIONS = 5000000;      // 默认往返次数
+constexpr size_t DEFAULT_WARMUP = 100000;           // 默认预热往返次数(不计入统计)
+
+using PingQueue = NBQueue<TestData, PING_QUEUE_CAPACITY>;
+
+static inline void cpu_relax() {
+    #if defined(__x86_64__)
+        _mm_pause();
+    #elif defined(__aarch64__)
+        asm volatile("yield");
+    #endif
+}
+
+/**
+ * @brief 命令行参数
+ */
+struct Options {
+    size_t iterations = DEFAULT_ITERATIONS;
+    size_t warmup = DEFAULT_WARMUP;
+    std::string placement;        // 为空表示不绑核
+    int cpu_ping = -1;            // 显式指定的发起方CPU
+    int cpu_pong = -1;            // 显式指定的应答方CPU
+    bool show_distribution = false;
+};
+
+static void print_usage(const char* prog) {
+    std::cout << "用法: " << prog << " [选项]\n"
+              << "  --iterations N    往返次数(默认 " << DEFAULT_ITERATIONS << ")\n"
+              << "  --warmup N        预热往返次数(默认 " << DEFAULT_WARMUP << ")\n"
+              << "  --placement P     same-core-ht | same-socket | cross-socket\n"
+              << "  --cpus A,B        显式指定发起方/应答方CPU(优先于 --placement)\n"
+              << "  --distribution    输出完整的RTT分布\n";
+}
+
+static bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--iterations" && has_value) {
+            options.iterations = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--warmup" && has_value) {
+            options.warmup = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--placement" && has_value) {
+            options.placement = argv[++i];
+        } else if (arg == "--cpus" && has_value) {
+            if (std::sscanf(argv[++i], "%d,%d", &options.cpu_ping, &options.cpu_pong) != 2) {
+                return false;
+            }
+        } else if (arg == "--distribution") {
+            options.show_distribution = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 命名当前线程并按需绑核，失败时输出原因
+ */
+static void setup_thread(const char* name, int cpu) {
+    ThreadOptions thread_options;
+    thread_options.name = name;
+    if (cpu >= 0) {
+        thread_options.cpus = {cpu};
+    }
+    const auto result = apply_thread_options(thread_options);
+    if (!result.ok()) {
+        std::cerr << name << ": " << result.describe();
+    }
+}
+
+/**
+ * @brief 应答方: 从 ping 队列取消息，原样放回 pong 队列
+ */
+static void run_ponger(PingQueue& ping, PingQueue& pong, size_t total, int cpu) {
+    setup_thread("ponger", cpu);
+    for (size_t i = 0; i < total; ++i) {
+        std::optional<TestData> message;
+        while (!(message = ping.pop())) {
+            cpu_relax();
+        }
+        while (!pong.push(std::move(*message))) {
+            cpu_relax();
+        }
+    }
+}
+
+/**
+ * @brief 发起方: 发送消息并等待回应，记录每次往返耗时
+ */
+static void run_pinger(PingQueue& ping, PingQueue& pong, const Options& options,
+                       int cpu, LatencyHistogram& histogram) {
+    setup_thread("pinger", cpu);
+    const size_t total = options.warmup + options.iterations;
+    for (size_t i = 0; i < total; ++i) {
+        TestData message(i);
+        const auto start = HighResolutionTimer::now();
+        message.timestamp = start;
+        while (!ping.push(std::move(message))) {
+            cpu_relax();
+        }
+        std::optional<TestData> reply;
+        while (!(reply = pong.pop())) {
+            cpu_relax();
+        }
+        const auto end = HighResolutionTimer::now();
+        if (i >= options.warmup) {
+            histogram.record(end - start);
+        }
+    }
+}
+
+/**
+ * @brief 两个线程通过一对 NBQueue 往返传递消息，测量往返延迟(RTT)
+ *
+ * 单向延迟按 RTT/2 估算。
+ */
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 初始化高精度计时器
+    HighResolutionTimer::init();
+
+    if (options.cpu_ping < 0 && !options.placement.empty()) {
+        const auto placement = CpuTopology::parse_placement(options.placement);
+        if (!placement) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        CpuTopology topology;
+        const auto pair = topology.find_pair(*placement);
+        if (!pair) {
+            std::cerr << "本机没有满足 " << options.placement << " 的CPU组合\n";
+            return 1;
+        }
+        options.cpu_ping = pair->first;
+        options.cpu_pong = pair->second;
+    }
+
+    std::cout << "往返次数: " << options.iterations << ", 预热: " << options.warmup << "\n";
+    if (options.cpu_ping >= 0) {
+        std::cout << "发起方CPU: " << options.cpu_ping << ", 应答方CPU: " << options.cpu_pong << "\n";
+    } else {
+        std::cout << "未绑核\n";
+    }
+#if QUEUE_PERF_STATS
+    std::cout << "注意: NBQueue 启用了性能统计(QUEUE_PERF_STATS)，结果包含统计开销\n";
+#endif
+
+    // 两个队列放在各自消费者所在的NUMA节点上
+    ThreadOptions pinger_options;
+    ThreadOptions ponger_options;
+    if (options.cpu_ping >= 0) {
+        pinger_options.cpus = {options.cpu_ping};
+        ponger_options.cpus = {options.cpu_pong};
+    }
+    auto ping = make_queue_for_pair<PingQueue>(pinger_options, ponger_options);
+    auto pong = make_queue_for_pair<PingQueue>(ponger_options, pinger_options);
+    LatencyHistogram histogram;
+
+    std::thread ponger(run_ponger, std::ref(*ping), std::ref(*pong),
+                       options.warmup + options.iterations, options.cpu_pong);
+    std::thread pinger(run_pinger, std::ref(*ping), std::ref(*pong), std::cref(options),
+                       options.cpu_ping, std::ref(histogram));
+    pinger.join();
+    ponger.join();
+
+    std::cout << "\n=== 往返延迟(RTT) ===\n" << histogram.get_stats();
+    std::cout << "\n=== 单向延迟(RTT/2) ===\n" << histogram.get_stats(0.5);
+    if (options.show_distribution) {
+        std::cout << "\n=== RTT分布 ===\n" << histogram.get_distribution();
+    }
+    return 0;
+}
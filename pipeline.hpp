@@ -0,0 +1,455 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "timer.hpp"
+#include "span.hpp"
+#include "thread_options.hpp"
+#include "queue.hpp"
+#include "lock_free_queue_consumer.hpp"
+
+/**
+ * @brief 流水线阶段基类，使用CRTP模式
+ * @tparam Derived 派生类类型
+ * @tparam In 输入消息类型
+ * @tparam Out 输出消息类型，void 表示终点阶段(只消费不输出)
+ *
+ * 派生类实现以下之一:
+ * - Out process(In&&)                  每条输入产生一条输出
+ * - std::optional<Out> process(In&&)   返回 nullopt 时丢弃该消息(例如风控拒绝)
+ * - void process(In&&)                 终点阶段，Out 为 void
+ * 阶段对象由流水线持有，只在所属阶段的线程中被调用，内部状态不需要加锁。
+ */
+template<typename Derived, typename In, typename Out = void>
+class PipelineStage {
+public:
+    using input_type = In;
+    using output_type = Out;
+
+protected:
+    PipelineStage() = default;
+
+private:
+    template<typename Stage, size_t Capacity>
+    friend class PipelineStageRunner;
+
+    /**
+     * @brief 处理一条消息，有输出时交给 emit
+     * @return 产生了输出返回true，被过滤或终点阶段返回false
+     */
+    template<typename Emit>
+    bool handle(In&& in, Emit&& emit) {
+        Derived& self = static_cast<Derived&>(*this);
+        if constexpr (std::is_void_v<Out>) {
+            self.process(std::move(in));
+            return false;
+        } else if constexpr (std::is_same_v<decltype(self.process(std::move(in))), std::optional<Out>>) {
+            std::optional<Out> result = self.process(std::move(in));
+            if (!result) {
+                return false;
+            }
+            emit(*result);
+            return true;
+        } else {
+            Out result = self.process(std::move(in));
+            emit(result);
+            return true;
+        }
+    }
+};
+
+/**
+ * @brief 单个阶段的运行统计快照
+ */
+struct PipelineStageReport {
+    std::string name;            // 阶段名
+    uint64_t processed = 0;      // 处理的消息数
+    uint64_t emitted = 0;        // 输出到下游的消息数
+    uint64_t filtered = 0;       // 被过滤的消息数
+    uint64_t backlog = 0;        // 输入队列当前积压的消息数
+    double throughput = 0;       // 吞吐量(消息/秒)
+    double avg_service_ns = 0;   // 每条消息的平均处理耗时，不含等待下游队列的时间
+    double max_batch_ns = 0;     // 单批处理的最大耗时
+    double blocked_ratio = 0;    // 等待下游队列腾出空间的时间占运行时间的比例
+};
+
+/**
+ * @brief 流水线中类型擦除后的阶段，统一管理启动、停止和统计
+ */
+class PipelineNode {
+public:
+    virtual ~PipelineNode() = default;
+
+    virtual ThreadSetupResult start(const ThreadOptions& options) = 0;
+
+    /**
+     * @brief 处理完停止时输入队列中已有的消息后停止
+     */
+    virtual void drain_and_stop() = 0;
+
+    virtual PipelineStageReport report(double elapsed_sec) const = 0;
+
+    virtual const std::string& name() const = 0;
+};
+
+/**
+ * @brief 运行一个阶段的消费者线程: 从输入队列批量取出，调用阶段处理，写入输出队列
+ * @tparam Stage 阶段类型，派生自 PipelineStage
+ * @tparam Capacity 阶段之间队列的容量
+ *
+ * 输出队列满时自旋等待(反压)，不丢弃消息，因此下游必须一直有人消费。
+ */
+template<typename Stage, size_t Capacity>
+class PipelineStageRunner final
+    : public PipelineNode
+    , public LockFreeQueueConsumer<PipelineStageRunner<Stage, Capacity>, typename Stage::input_type, Capacity> {
+private:
+    using In = typename Stage::input_type;
+    using Out = typename Stage::output_type;
+    using Base = LockFreeQueueConsumer<PipelineStageRunner<Stage, Capacity>, In, Capacity>;
+    using OutputQueue = std::conditional_t<std::is_void_v<Out>, void, NBQueue<std::conditional_t<std::is_void_v<Out>, char, Out>, Capacity>>;
+    friend Base;  // 允许基类访问on_batch
+
+    std::string name_;                   // 阶段名
+    Stage stage_;                        // 阶段对象
+    NBQueue<In, Capacity>& input_;       // 输入队列
+    OutputQueue* output_;                // 输出队列，终点阶段为nullptr
+
+    // 只由阶段线程写入，报告时读取
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> emitted_{0};
+    std::atomic<uint64_t> busy_ticks_{0};       // 处理耗时，含等待下游
+    std::atomic<uint64_t> blocked_ticks_{0};    // 等待下游队列的耗时
+    std::atomic<uint64_t> max_batch_ticks_{0};
+
+    /**
+     * @brief 把输出写入下游队列，队列满时等待
+     */
+    template<typename Value>
+    void emit(Value& value) {
+        if (output_->try_push(value)) {
+            return;
+        }
+        const auto blocked_start = HighResolutionTimer::now();
+        while (!output_->try_push(value)) {
+            #if defined(__x86_64__)
+                _mm_pause();
+            #elif defined(__aarch64__)
+                asm volatile("yield");
+            #endif
+        }
+        blocked_ticks_.fetch_add(HighResolutionTimer::now() - blocked_start, std::memory_order_relaxed);
+    }
+
+    void on_batch(Span<In> batch) {
+        const auto start_time = HighResolutionTimer::now();
+        uint64_t emitted = 0;
+        for (auto& item : batch) {
+            if (stage_.handle(std::move(item), [this](auto& value) { emit(value); })) {
+                emitted++;
+            }
+        }
+        const auto duration = HighResolutionTimer::now() - start_time;
+
+        processed_.fetch_add(batch.size(), std::memory_order_relaxed);
+        emitted_.fetch_add(emitted, std::memory_order_relaxed);
+        busy_ticks_.fetch_add(duration, std::memory_order_relaxed);
+        if (duration > max_batch_ticks_.load(std::memory_order_relaxed)) {
+            max_batch_ticks_.store(duration, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    template<typename... Args>
+    PipelineStageRunner(std::string name, NBQueue<In, Capacity>& input, OutputQueue* output, Args&&... args)
+        : Base(input)
+        , name_(std::move(name))
+        , stage_(std::forward<Args>(args)...)
+        , input_(input)
+        , output_(output) {}
+
+    /**
+     * @brief 先停止线程再析构阶段对象，避免线程访问已析构的成员
+     */
+    ~PipelineStageRunner() override {
+        Base::stop();
+    }
+
+    ThreadSetupResult start(const ThreadOptions& options) override {
+        return Base::start(options);
+    }
+
+    void drain_and_stop() override {
+        const uint64_t target = input_.tail_sequence();
+        while (input_.head_sequence() < target) {
+            std::this_thread::yield();
+        }
+        Base::stop();
+    }
+
+    PipelineStageReport report(double elapsed_sec) const override {
+        PipelineStageReport report;
+        report.name = name_;
+        report.processed = processed_.load(std::memory_order_relaxed);
+        report.emitted = emitted_.load(std::memory_order_relaxed);
+        report.filtered = std::is_void_v<Out> ? 0 : report.processed - report.emitted;
+        const uint64_t head = input_.head_sequence();
+        const uint64_t tail = input_.tail_sequence();
+        report.backlog = tail > head ? tail - head : 0;
+        if (elapsed_sec > 0) {
+            report.throughput = report.processed / elapsed_sec;
+            report.blocked_ratio = HighResolutionTimer::to_sec(blocked_ticks_.load(std::memory_order_relaxed)) / elapsed_sec;
+        }
+        if (report.processed > 0) {
+            const uint64_t busy = busy_ticks_.load(std::memory_order_relaxed);
+            const uint64_t blocked = blocked_ticks_.load(std::memory_order_relaxed);
+            report.avg_service_ns = HighResolutionTimer::to_ns(busy > blocked ? busy - blocked : 0) / report.processed;
+        }
+        report.max_batch_ns = HighResolutionTimer::to_ns(max_batch_ticks_.load(std::memory_order_relaxed));
+        return report;
+    }
+
+    const std::string& name() const override {
+        return name_;
+    }
+};
+
+/**
+ * @brief 由 PipelineBuilder 构建的流水线
+ * @tparam In 输入消息类型
+ * @tparam Out 最后一个阶段的输出类型，void 表示以终点阶段结束
+ * @tparam Capacity 阶段之间队列的容量
+ *
+ * 持有所有阶段之间的队列和阶段线程。通过 input() 写入消息(可以直接接 LockFreeQueueProducer)，
+ * Out 不为 void 时通过 output() 取出最后一个阶段的输出，output() 必须有人消费，
+ * 否则最后一个阶段会因反压阻塞。
+ */
+template<typename In, typename Out, size_t Capacity>
+class Pipeline {
+public:
+    ~Pipeline() {
+        stop();
+    }
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    Pipeline(Pipeline&&) = default;
+
+    /**
+     * @brief 流水线的输入队列
+     */
+    NBQueue<In, Capacity>& input() {
+        return *input_;
+    }
+
+    /**
+     * @brief 最后一个阶段的输出队列
+     */
+    template<typename O = Out, typename = std::enable_if_t<!std::is_void_v<O>>>
+    NBQueue<O, Capacity>& output() {
+        return *static_cast<NBQueue<O, Capacity>*>(output_);
+    }
+
+    /**
+     * @brief 启动所有阶段，从最后一个阶段开始，保证每个阶段启动时下游已经在消费
+     * @param options 各阶段的线程选项，按阶段顺序对应，缺省或线程名为空时以阶段名命名
+     * @return 各阶段线程选项的应用结果，按阶段顺序
+     */
+    std::vector<ThreadSetupResult> start(const std::vector<ThreadOptions>& options = {}) {
+        std::vector<ThreadSetupResult> results(nodes_.size());
+        if (running_) {
+            return results;
+        }
+        for (size_t i = nodes_.size(); i-- > 0;) {
+            ThreadOptions stage_options = i < options.size() ? options[i] : ThreadOptions{};
+            if (stage_options.name.empty()) {
+                stage_options.name = nodes_[i]->name().substr(0, 15);
+            }
+            results[i] = nodes_[i]->start(stage_options);
+        }
+        start_time_ = HighResolutionTimer::now();
+        running_ = true;
+        return results;
+    }
+
+    /**
+     * @brief 停止所有阶段，从第一个阶段开始
+     *
+     * 每个阶段先处理完输入队列中已有的消息再停止，下游此时仍在运行，
+     * 因此停止后阶段之间的队列都是空的，不会丢消息。
+     * 调用前应先停止向 input() 写入的生产者，否则之后写入的消息留在输入队列中。
+     */
+    void stop() {
+        if (!running_) {
+            return;
+        }
+        for (auto& node : nodes_) {
+            node->drain_and_stop();
+        }
+        stop_time_ = HighResolutionTimer::now();
+        running_ = false;
+    }
+
+    /**
+     * @brief 阶段数
+     */
+    size_t stage_count() const {
+        return nodes_.size();
+    }
+
+    /**
+     * @brief 各阶段的统计快照，按阶段顺序
+     *
+     * 吞吐量按流水线从启动到停止(运行中则到现在)的时间计算。
+     */
+    std::vector<PipelineStageReport> stage_reports() const {
+        const uint64_t end_time = running_ ? HighResolutionTimer::now() : stop_time_;
+        const double elapsed_sec = start_time_ > 0 ? HighResolutionTimer::to_sec(end_time - start_time_) : 0.0;
+        std::vector<PipelineStageReport> reports;
+        reports.reserve(nodes_.size());
+        for (const auto& node : nodes_) {
+            reports.push_back(node->report(elapsed_sec));
+        }
+        return reports;
+    }
+
+    /**
+     * @brief 整条流水线的统计报告
+     *
+     * 逐个阶段列出吞吐量、平均处理耗时、等待下游的时间占比和输入积压，并指出瓶颈阶段:
+     * 平均处理耗时最长的阶段决定了整条流水线的最大吞吐量(约为 1e9 / 平均处理耗时 条/秒)。
+     */
+    std::string report() const {
+        const auto reports = stage_reports();
+        std::stringstream ss;
+        ss << "流水线统计:\n";
+        const PipelineStageReport* bottleneck = nullptr;
+        for (size_t i = 0; i < reports.size(); ++i) {
+            const auto& r = reports[i];
+            ss << "阶段 " << i << " [" << r.name << "]: "
+               << "处理 " << r.processed
+               << ", 输出 " << r.emitted
+               << ", 过滤 " << r.filtered
+               << ", 吞吐量 " << r.throughput << " 条/秒"
+               << ", 平均处理耗时 " << r.avg_service_ns << " ns"
+               << ", 最大批耗时 " << r.max_batch_ns << " ns"
+               << ", 等待下游占比 " << r.blocked_ratio * 100 << "%"
+               << ", 输入积压 " << r.backlog << "\n";
+            if (r.processed > 0 && (!bottleneck || r.avg_service_ns > bottleneck->avg_service_ns)) {
+                bottleneck = &r;
+            }
+        }
+        if (bottleneck && bottleneck->avg_service_ns > 0) {
+            ss << "瓶颈阶段: " << bottleneck->name
+               << ", 流水线最大吞吐量约 " << 1e9 / bottleneck->avg_service_ns << " 条/秒\n";
+        }
+        return ss.str();
+    }
+
+private:
+    template<typename, size_t, typename>
+    friend class PipelineBuilder;
+
+    Pipeline() = default;
+
+    // 声明顺序保证先析构阶段(停止线程)再析构队列
+    std::vector<std::shared_ptr<void>> queues_;         // 所有队列，类型已擦除
+    std::vector<std::unique_ptr<PipelineNode>> nodes_;  // 按顺序排列的阶段
+    NBQueue<In, Capacity>* input_ = nullptr;            // 输入队列
+    void* output_ = nullptr;                            // 输出队列，终点阶段结束时为nullptr
+    bool running_ = false;
+    uint64_t start_time_ = 0;
+    uint64_t stop_time_ = 0;
+};
+
+/**
+ * @brief 流水线构建器，按顺序追加阶段，编译期检查相邻阶段的消息类型
+ * @tparam In 流水线输入消息类型
+ * @tparam Capacity 阶段之间队列的容量
+ * @tparam Out 目前最后一个阶段的输出类型
+ *
+ * 用法:
+ *   auto pipeline = PipelineBuilder<RawMsg, 4096>()
+ *       .then<Decode>("decode")
+ *       .then<Enrich>("enrich", std::cref(reference_data))   // 其余参数转发给阶段的构造函数
+ *       .then<RiskCheck>("risk")
+ *       .then<Publish>("publish")
+ *       .build();
+ *   pipeline.start();
+ *   LockFreeQueueProducer producer(pipeline.input(), generate);
+ *   ...
+ *   producer.stop();
+ *   pipeline.stop();
+ *   std::cout << pipeline.report();
+ *
+ * 每个阶段是一个消费者线程，构建器在相邻阶段之间分配一个 NBQueue。
+ */
+template<typename In, size_t Capacity, typename Out = In>
+class PipelineBuilder {
+public:
+    PipelineBuilder()
+        : pipeline_(new Pipeline<In, Out, Capacity>()) {
+        static_assert(std::is_same_v<In, Out>, "从空的构建器开始时输入和输出类型相同");
+        auto input = std::make_shared<NBQueue<In, Capacity>>();
+        pipeline_->input_ = input.get();
+        tail_ = input.get();
+        pipeline_->queues_.push_back(std::move(input));
+    }
+
+    /**
+     * @brief 追加一个阶段
+     * @tparam Stage 阶段类型，输入类型必须与当前输出类型一致
+     * @param name 阶段名，用于线程名和统计报告
+     * @param args 转发给阶段构造函数的参数
+     */
+    template<typename Stage, typename... Args>
+    PipelineBuilder<In, Capacity, typename Stage::output_type> then(std::string name, Args&&... args) && {
+        static_assert(!std::is_void_v<Out>, "终点阶段之后不能再追加阶段");
+        static_assert(std::is_same_v<typename Stage::input_type, Out>, "阶段的输入类型与上一个阶段的输出类型不一致");
+        using Next = typename Stage::output_type;
+
+        PipelineBuilder<In, Capacity, Next> next(std::move(pipeline_));
+        QueueOf<Next>* output = nullptr;
+        if constexpr (!std::is_void_v<Next>) {
+            auto queue = std::make_shared<NBQueue<Next, Capacity>>();
+            output = queue.get();
+            next.pipeline_->queues_.push_back(std::move(queue));
+        }
+        next.pipeline_->nodes_.push_back(std::make_unique<PipelineStageRunner<Stage, Capacity>>(
+            std::move(name), *tail_, output, std::forward<Args>(args)...));
+        next.tail_ = output;
+        return next;
+    }
+
+    /**
+     * @brief 完成构建，返回的流水线尚未启动
+     */
+    Pipeline<In, Out, Capacity> build() && {
+        pipeline_->output_ = tail_;
+        return std::move(*pipeline_);
+    }
+
+private:
+    template<typename, size_t, typename>
+    friend class PipelineBuilder;
+
+    template<typename T>
+    using QueueOf = std::conditional_t<std::is_void_v<T>, void, NBQueue<std::conditional_t<std::is_void_v<T>, char, T>, Capacity>>;
+
+    template<typename PreviousOut>
+    explicit PipelineBuilder(std::unique_ptr<Pipeline<In, PreviousOut, Capacity>> pipeline)
+        : pipeline_(new Pipeline<In, Out, Capacity>()) {
+        pipeline_->queues_ = std::move(pipeline->queues_);
+        pipeline_->nodes_ = std::move(pipeline->nodes_);
+        pipeline_->input_ = pipeline->input_;
+    }
+
+    std::unique_ptr<Pipeline<In, Out, Capacity>> pipeline_;   // 构建中的流水线
+    QueueOf<Out>* tail_ = nullptr;                            // 最后一个阶段的输出队列
+};
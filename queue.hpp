@@ -1,11 +1,15 @@
 #pragma once
 #include <atomic>
+#include <cstdint>
+#include <algorithm>
 #include <array>
 #include <optional>
-#include <span>
 #include <thread>
+#include <vector>
 #include <sstream>
 #include "timer.hpp"
+#include "span.hpp"
+#include "queue_notifier.hpp"
 
 /**
  * @brief 队列性能统计类
@@ -41,6 +45,43 @@ public:
         update_max_min_push_time(duration);
     }
 
+    /**
+     * @brief 记录一次批量push，并统计耗时
+     * @param start_time push_bulk操作开始时间
+     * @param count 本次写入的元素个数
+     *
+     * 与push一样按操作计数: 一次调用是一次尝试、至多一次成功，写入的元素数另计。
+     */
+    void record_push_bulk(uint64_t start_time, size_t count) {
+        const auto end_time = HighResolutionTimer::now();
+        const auto duration = end_time - start_time;
+
+        push_bulk_calls++;
+        push_bulk_items += count;
+        if (count > 0) {
+            push_success++;
+            push_total_ticks += duration;
+            update_max_min_push_time(duration);
+        } else {
+            push_failures++;
+        }
+    }
+
+    /**
+     * @brief 记录因队列满而丢弃的最旧元素
+     * @param count 丢弃个数
+     */
+    void record_evicted(size_t count) {
+        evicted += count;
+    }
+
+    /**
+     * @brief 记录一次队尾元素被原地覆盖
+     */
+    void record_overwritten() {
+        overwritten++;
+    }
+
     /**
      * @brief 记录一次push失败
      */
@@ -75,6 +116,31 @@ public:
         update_max_min_pop_time(duration);
     }
 
+    /**
+     * @brief 记录一次批量pop，并统计耗时
+     * @param start_time pop_bulk操作开始时间
+     * @param count 本次弹出的元素个数
+     *
+     * 与pop一样按操作计数，弹出的元素数另计。
+     */
+    void record_pop_bulk(uint64_t start_time, size_t count) {
+        const auto end_time = HighResolutionTimer::now();
+        const auto duration = end_time - start_time;
+
+        pop_bulk_calls++;
+        pop_bulk_items += count;
+        pop_success++;
+        pop_total_ticks += duration;
+        update_max_min_pop_time(duration);
+    }
+
+    /**
+     * @brief 记录一次取走节点时等待观察者拷贝完成
+     */
+    void record_reader_wait() {
+        reader_waits++;
+    }
+
     /**
      * @brief 记录一次pop空队列
      */
@@ -102,6 +168,24 @@ public:
         update_max_min_read_time(duration);
     }
 
+    /**
+     * @brief 记录一次批量读取，并统计耗时
+     * @param start_time read_batch操作开始时间
+     * @param count 本次读到的元素个数
+     */
+    void record_read_batch(uint64_t start_time, size_t count) {
+        const auto end_time = HighResolutionTimer::now();
+        const auto duration = end_time - start_time;
+
+        read_batch_calls++;
+        read_batch_items += count;
+        if (count > 0) {
+            read_at_success++;
+            read_total_ticks += duration;
+            update_max_min_read_time(duration);
+        }
+    }
+
     /**
      * @brief 获取性能统计信息的字符串表示
      * @return 包含所有性能指标的格式化字符串
@@ -117,8 +201,17 @@ public:
         ss << "  成功次数: " << push_success.load() << "\n";
         ss << "  失败次数: " << push_failures.load() << "\n";
         ss << "  自旋次数: " << push_spins.load() << "\n";
-        if (push_count > 0) {
-            const auto avg_ns = HighResolutionTimer::to_ns(push_total_ticks.load() / push_count);
+        ss << "  丢弃最旧元素数: " << evicted.load() << "\n";
+        ss << "  覆盖最新元素数: " << overwritten.load() << "\n";
+        const auto bulk_calls = push_bulk_calls.load();
+        if (bulk_calls > 0) {
+            ss << "  批量push次数: " << bulk_calls << "\n";
+            ss << "  平均批量大小: " << static_cast<double>(push_bulk_items.load()) / bulk_calls << "\n";
+        }
+        const auto push_ok = push_success.load();
+        if (push_ok > 0) {
+            // 只有成功的操作计入耗时
+            const auto avg_ns = HighResolutionTimer::to_ns(push_total_ticks.load() / push_ok);
             const auto max_ns = HighResolutionTimer::to_ns(push_max_ticks.load());
             const auto min_ns = HighResolutionTimer::to_ns(push_min_ticks.load());
             ss << "  平均耗时: " << avg_ns << " ns\n";
@@ -132,8 +225,15 @@ public:
         ss << "  尝试次数: " << pop_count << "\n";
         ss << "  成功次数: " << pop_success.load() << "\n";
         ss << "  空队列次数: " << pop_empty.load() << "\n";
-        if (pop_count > 0) {
-            const auto avg_ns = HighResolutionTimer::to_ns(pop_total_ticks.load() / pop_count);
+        ss << "  等待观察者次数: " << reader_waits.load() << "\n";
+        const auto pop_batches = pop_bulk_calls.load();
+        if (pop_batches > 0) {
+            ss << "  批量pop次数: " << pop_batches << "\n";
+            ss << "  平均批量大小: " << static_cast<double>(pop_bulk_items.load()) / pop_batches << "\n";
+        }
+        const auto pop_ok = pop_success.load();
+        if (pop_ok > 0) {
+            const auto avg_ns = HighResolutionTimer::to_ns(pop_total_ticks.load() / pop_ok);
             const auto max_ns = HighResolutionTimer::to_ns(pop_max_ticks.load());
             const auto min_ns = HighResolutionTimer::to_ns(pop_min_ticks.load());
             ss << "  平均耗时: " << avg_ns << " ns\n";
@@ -146,8 +246,14 @@ public:
         const auto read_count = read_at_attempts.load();
         ss << "  尝试次数: " << read_count << "\n";
         ss << "  成功次数: " << read_at_success.load() << "\n";
-        if (read_count > 0) {
-            const auto avg_ns = HighResolutionTimer::to_ns(read_total_ticks.load() / read_count);
+        const auto read_batches = read_batch_calls.load();
+        if (read_batches > 0) {
+            ss << "  批量读取次数: " << read_batches << "\n";
+            ss << "  平均批量大小: " << static_cast<double>(read_batch_items.load()) / read_batches << "\n";
+        }
+        const auto read_ok = read_at_success.load();
+        if (read_ok > 0) {
+            const auto avg_ns = HighResolutionTimer::to_ns(read_total_ticks.load() / read_ok);
             const auto max_ns = HighResolutionTimer::to_ns(read_max_ticks.load());
             const auto min_ns = HighResolutionTimer::to_ns(read_min_ticks.load());
             ss << "  平均耗时: " << avg_ns << " ns\n";
@@ -166,6 +272,10 @@ public:
         push_success = 0;
         push_spins = 0;
         push_failures = 0;
+        push_bulk_calls = 0;
+        push_bulk_items = 0;
+        evicted = 0;
+        overwritten = 0;
         push_total_ticks = 0;
         push_max_ticks = 0;
         push_min_ticks = UINT64_MAX;
@@ -173,12 +283,17 @@ public:
         pop_attempts = 0;
         pop_success = 0;
         pop_empty = 0;
+        reader_waits = 0;
+        pop_bulk_calls = 0;
+        pop_bulk_items = 0;
         pop_total_ticks = 0;
         pop_max_ticks = 0;
         pop_min_ticks = UINT64_MAX;
         
         read_at_attempts = 0;
         read_at_success = 0;
+        read_batch_calls = 0;
+        read_batch_items = 0;
         read_total_ticks = 0;
         read_max_ticks = 0;
         read_min_ticks = UINT64_MAX;
@@ -190,6 +305,10 @@ private:
     std::atomic<size_t> push_success{0};     // push成功次数
     std::atomic<size_t> push_spins{0};       // push自旋次数
     std::atomic<size_t> push_failures{0};    // push失败次数
+    std::atomic<size_t> push_bulk_calls{0};  // push_bulk调用次数
+    std::atomic<size_t> push_bulk_items{0};  // push_bulk写入的元素总数
+    std::atomic<size_t> evicted{0};          // 为腾出空间丢弃的最旧元素数
+    std::atomic<size_t> overwritten{0};      // 被原地覆盖的队尾元素数
     std::atomic<uint64_t> push_total_ticks{0}; // push总耗时
     std::atomic<uint64_t> push_max_ticks{0};   // push最大耗时
     std::atomic<uint64_t> push_min_ticks{UINT64_MAX}; // push最小耗时
@@ -198,6 +317,9 @@ private:
     std::atomic<size_t> pop_attempts{0};     // pop尝试次数
     std::atomic<size_t> pop_success{0};      // pop成功次数
     std::atomic<size_t> pop_empty{0};        // 队列为空的次数
+    std::atomic<size_t> reader_waits{0};     // 取走节点时等待观察者的自旋次数
+    std::atomic<size_t> pop_bulk_calls{0};   // 成功的pop_bulk调用次数
+    std::atomic<size_t> pop_bulk_items{0};   // pop_bulk弹出的元素总数
     std::atomic<uint64_t> pop_total_ticks{0};  // pop总耗时
     std::atomic<uint64_t> pop_max_ticks{0};    // pop最大耗时
     std::atomic<uint64_t> pop_min_ticks{UINT64_MAX};  // pop最小耗时
@@ -205,6 +327,8 @@ private:
     // Read_at 操作相关的原子计数器
     std::atomic<size_t> read_at_attempts{0};   // read_at尝试次数
     std::atomic<size_t> read_at_success{0};    // read_at成功次数
+    std::atomic<size_t> read_batch_calls{0};   // read_batch调用次数
+    std::atomic<size_t> read_batch_items{0};   // read_batch读到的元素总数
     std::atomic<uint64_t> read_total_ticks{0}; // read_at总耗时
     std::atomic<uint64_t> read_max_ticks{0};   // read_at最大耗时
     std::atomic<uint64_t> read_min_ticks{UINT64_MAX}; // read_at最小耗时
@@ -253,39 +377,64 @@ private:
 };
 #endif
 
+/**
+ * @brief 队列满时的溢出策略
+ */
+enum class OverflowPolicy {
+    Block,             // 保留消息，等待队列有空间后再写入，不丢数据
+    DropNewest,        // 丢弃新消息
+    DropOldest,        // 丢弃队列中最旧的消息，为新消息腾出空间
+    OverwriteLatest,   // 原地覆盖队尾的最新消息(最新值语义)
+    Spill,             // 写入生产者的溢出文件，队列有空间后按顺序补回，不丢数据
+};
+
 /**
  * @brief 无锁环形队列实现
  * @tparam T 队列元素类型
  * @tparam Capacity 队列容量
+ *
+ * 读写索引是单调递增的64位序号，槽位下标为 序号 % Capacity。
+ * 生产者和消费者都先用CAS在索引上认领序号，再操作对应槽位，因此支持多生产者多消费者:
+ * - 生产者认领写序号后，等上一圈的消息被清空再写入节点
+ * - 消费者只有在槽位中已是自己要取的序号时才认领读序号，认领后独占该槽位
+ * 每个槽位记录当前消息的序号，按序号读取的观察者据此区分"还没写入"和"已被移除、槽位被复用"，
+ * 从而发现自己落后太多而漏掉的消息。
+ *
+ * 观察者(read_at/read_sequence/read_batch/access_sequence)读取节点期间在槽位的读者计数上登记，
+ * 取走或替换节点的一方(pop/pop_bulk/丢弃最旧/覆盖最新)先把槽位中的指针换掉，
+ * 再等该槽位的读者计数归零后才移动或释放旧节点，因此观察者可以与消费者、溢出策略并存。
+ * 观察者从不等待；消费者最多等待正在拷贝同一条消息的观察者拷贝完成。
  */
 template<typename T, size_t Capacity>
 class NBQueue {
+    static_assert(Capacity >= 2, "NBQueue 需要保留一个空槽位，容量至少为2");
+
+    /**
+     * @brief 槽位: 消息节点指针及其序号
+     */
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};   // 当前节点的序号，先于节点指针发布
+        std::atomic<T*> data{nullptr};       // 消息节点，空表示尚未写入或已被取走
+        mutable std::atomic<uint32_t> readers{0};  // 正在访问该槽位节点的观察者数
+    };
+
     // 使用64字节对齐以避免伪共享
-    alignas(64) std::array<std::atomic<T*>, Capacity> buffer_{}; // 使用固定大小数组存储数据
-    alignas(64) std::atomic<size_t> read_index_{0};   // 读取位置索引
-    alignas(64) std::atomic<size_t> write_index_{0};  // 写入位置索引
+    alignas(64) std::array<Slot, Capacity> buffer_{}; // 使用固定大小数组存储数据
+    alignas(64) std::atomic<uint64_t> read_index_{0};   // 读取序号，即最早未被移除的消息
+    alignas(64) std::atomic<uint64_t> write_index_{0};  // 写入序号，即下一条消息的序号
+
+    QueueNotifier* notifier_ = nullptr;  // 可选的通知通道，写入后按需唤醒睡眠中的消费者
 
 #if QUEUE_PERF_STATS
     alignas(64) QueueStats stats_;  // 性能统计
 #endif
 
 public:
-    /**
-     * @brief 构造函数,初始化缓冲区
-     * 
-     * std::array 会自动零初始化所有元素，但我们仍然需要
-     * 正确初始化 std::atomic 对象
-     */
-    NBQueue() {
-        for (auto& slot : buffer_) {
-        // 初始化所有槽位为空指针
-            slot.store(nullptr, std::memory_order_relaxed);
-        }
-    }
+    NBQueue() = default;
 
     ~NBQueue() {
         for (auto& slot : buffer_) {
-            T* ptr = slot.load(std::memory_order_relaxed);
+            T* ptr = slot.data.load(std::memory_order_relaxed);
         // 清理所有未被消费的数据
             if (ptr) {
                 delete ptr;
@@ -298,17 +447,32 @@ public:
     NBQueue(const NBQueue&) = delete;
     NBQueue& operator=(const NBQueue&) = delete;
 
+    /**
+     * @brief 写入数据
+     * @param value 待写入的数据
+     * @return 成功返回true，队列满返回false
+     */
     bool push(T value) {
+        return try_push(value);
+    }
+
+    /**
+     * @brief 尝试写入数据，失败时保留原数据
+     * @param value 待写入的数据，只有写入成功时才会被移走
+     * @return 成功返回true，队列满返回false
+     *
+     * 便于调用方在队列满时保留消息稍后重试，而不必每次都额外拷贝一份。
+     */
+    bool try_push(T& value) {
 #if QUEUE_PERF_STATS
         const auto start_time = HighResolutionTimer::now();
         stats_.record_push_attempt();
 #endif
 
-        size_t current_write = write_index_.load(std::memory_order_relaxed);
-        size_t next_write = (current_write + 1) % Capacity;
+        uint64_t current_write = write_index_.load(std::memory_order_relaxed);
         
-        // 检查队列是否已满
-        if (next_write == read_index_.load(std::memory_order_acquire)) {
+        // 检查队列是否已满(保留一个空槽位)
+        if (is_full(current_write)) {
 #if QUEUE_PERF_STATS
             stats_.record_push_failure();
 #endif
@@ -326,33 +490,163 @@ public:
             return false;
         }
 
-        // 使用 compare_exchange_strong 确保写入操作的可靠性
-        T* expected = nullptr;
-        // 在这里使用 strong 版本是因为：
-        // 1. 这是队列的关键写入操作，我们不能容忍虚假失败
-        // 2. 失败代价较高（需要删除新分配的内存）
-        // 3. 在大多数平台上，CAS操作都是直接映射到硬件原语，性能差异不大
-        bool success = buffer_[current_write].compare_exchange_strong(
-            expected, new_data, std::memory_order_release, std::memory_order_relaxed);
-
-        if (success) {
-            write_index_.store(next_write, std::memory_order_release);
+        // 认领一个写序号，多个生产者各自拿到不同的序号
+        while (!write_index_.compare_exchange_weak(
+                current_write, current_write + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            if (is_full(current_write)) {
+                // 把数据还给调用方
+                value = std::move(*new_data);
+                delete new_data;
 #if QUEUE_PERF_STATS
-            stats_.record_push_success(start_time);
+                stats_.record_push_failure();
 #endif
-        } else {
+                return false;
+            }
+        }
+
+        store_slot(current_write, new_data);
+        if (notifier_) {
+            notifier_->notify();
+        }
+#if QUEUE_PERF_STATS
+        stats_.record_push_success(start_time);
+#endif
+        return true;
+    }
+
+    /**
+     * @brief 写入数据，队列满时丢弃最旧的元素腾出空间
+     * @param value 待写入的数据
+     * @return 为写入本条数据而丢弃的旧元素个数
+     *
+     * 总是写入成功。适合只关心最近一段数据、允许丢弃历史的场景。
+     * 被丢弃的节点经 unlink_node 取下，正在读取它的观察者拷贝完成后才释放。
+     */
+    size_t push_evict_oldest(T value) {
+        size_t evicted = 0;
+        while (!try_push(value)) {
+            if (discard_oldest()) {
+                evicted++;
+            }
+        }
+#if QUEUE_PERF_STATS
+        stats_.record_evicted(evicted);
+#endif
+        return evicted;
+    }
+
+    /**
+     * @brief 写入数据，队列满时原地覆盖最新的未消费元素(最新值语义)
+     * @param value 待写入的数据
+     * @return 覆盖了已有元素返回true，正常写入返回false
+     *
+     * 总是写入成功。队列满时不移动读写索引，直接替换队尾槽位中的数据，
+     * 消费者看到的最后一个元素始终是最新值，更早的元素保持原有顺序。
+     * 被替换的旧节点等正在读取它的观察者拷贝完成后才释放。
+     * 替换前在槽位上登记为读者，节点被取走并释放、同一地址被下一圈复用的ABA不会发生。
+     */
+    bool push_overwrite_latest(T value) {
+        while (!try_push(value)) {
+            const uint64_t current_write = write_index_.load(std::memory_order_acquire);
+            const uint64_t latest = current_write - 1;
+            Slot& slot = buffer_[latest % Capacity];
+            T* old_data = slot.data.load(std::memory_order_acquire);
+            if (!old_data || slot.sequence.load(std::memory_order_acquire) != latest) {
+                // 队尾元素刚被消费或还未写入完成，重新尝试
+                continue;
+            }
+
+            T* new_data = new T(std::move(value));
+            // 像观察者一样在槽位上登记后再读一次指针和序号: 登记期间旧节点不会被消费者释放，
+            // 其地址不会被下一圈的新节点复用，CAS 比较指针成功就说明槽位中仍是序号 latest 的节点(没有ABA)
+            slot.readers.fetch_add(1, std::memory_order_seq_cst);
+            old_data = slot.data.load(std::memory_order_seq_cst);
+            // 只有队尾元素仍未被消费时才替换，否则说明队列已有空间
+            const bool replaced = old_data != nullptr &&
+                                  slot.sequence.load(std::memory_order_acquire) == latest &&
+                                  slot.data.compare_exchange_strong(
+                                      old_data, new_data, std::memory_order_seq_cst, std::memory_order_relaxed);
+            slot.readers.fetch_sub(1, std::memory_order_release);
+            if (replaced) {
+                // 与 unlink_node 相同: 等正在拷贝旧节点的观察者离开后再释放
+                wait_for_readers(slot);
+                delete old_data;
+#if QUEUE_PERF_STATS
+                stats_.record_overwritten();
+#endif
+                return true;
+            }
+            value = std::move(*new_data);
             delete new_data;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 批量写入数据
+     * @param items 待写入的数据，成功写入的前缀会被移走
+     * @return 成功写入的个数(写入的是items的前缀)，队列满时可能小于items.size()
+     *
+     * 一次CAS认领一段连续的写序号，批量越大每条消息分摊的同步开销越小。
+     * 节点在认领序号之前分配好: 认领的序号必须全部写入，否则消费者和后续生产者会永远等在空槽位上。
+     * 节点分配失败时只写入已分配的部分；没写入的元素保持原值，调用方可以重试。
+     */
+    size_t push_bulk(Span<T> items) {
 #if QUEUE_PERF_STATS
-            stats_.record_push_failure();
+        const auto start_time = HighResolutionTimer::now();
+        stats_.record_push_attempt();
 #endif
+
+        uint64_t current_write = write_index_.load(std::memory_order_relaxed);
+        const size_t wanted = std::min(items.size(), free_slots(current_write));
+
+        // 每个线程复用同一个节点指针缓冲区，稳定后不再分配
+        static thread_local std::vector<T*> nodes;
+        size_t allocated = 0;
+        try {
+            if (nodes.size() < wanted) {
+                nodes.resize(wanted);
+            }
+            for (; allocated < wanted; ++allocated) {
+                nodes[allocated] = new T(std::move(items[allocated]));
+            }
+        } catch (...) {
+            // 只写入已分配好的前缀
         }
 
-        return success;
+        size_t count = 0;
+        do {
+            count = std::min(allocated, free_slots(current_write));
+            if (count == 0) {
+                break;
+            }
+        } while (!write_index_.compare_exchange_weak(
+                     current_write, current_write + count,
+                     std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        for (size_t i = 0; i < count; ++i) {
+            store_slot(current_write + i, nodes[i]);
+        }
+        // 其他生产者抢先占用了空间，没认领到序号的节点把数据还给调用方
+        for (size_t i = count; i < allocated; ++i) {
+            items[i] = std::move(*nodes[i]);
+            delete nodes[i];
+        }
+        if (count > 0 && notifier_) {
+            notifier_->notify();
+        }
+
+#if QUEUE_PERF_STATS
+        stats_.record_push_bulk(start_time, count);
+#endif
+        return count;
     }
 
     /**
      * @brief 从队列中弹出数据
      * @return 弹出的数据，如果队列为空则返回std::nullopt
+     *
+     * 多个消费者可以并发调用，每条消息只会被其中一个取走。
      */
     std::optional<T> pop() {
 #if QUEUE_PERF_STATS
@@ -360,25 +654,13 @@ public:
         stats_.record_pop_attempt();
 #endif
 
-        size_t current_read = read_index_.load(std::memory_order_relaxed);
-        
-        // 检查队列是否为空
-        if (current_read == write_index_.load(std::memory_order_acquire)) {
-#if QUEUE_PERF_STATS
-            stats_.record_pop_empty();
-#endif
-            return std::nullopt;
-        }
-
-        T* data = buffer_[current_read].exchange(nullptr, std::memory_order_acquire);
+        T* data = take_oldest();
         if (!data) {
 #if QUEUE_PERF_STATS
             stats_.record_pop_empty();
 #endif
             return std::nullopt;
         }
-
-        read_index_.store((current_read + 1) % Capacity, std::memory_order_release);
         
         std::optional<T> result{std::move(*data)};
         delete data;
@@ -390,6 +672,55 @@ public:
         return result;
     }
 
+    /**
+     * @brief 批量弹出数据
+     * @param out 输出缓冲区，最多弹出 out.size() 个，元素按顺序移动赋值到前缀中
+     * @param limit 只弹出序号小于 limit 的消息，用于等待依赖的阶段处理完(见 SequenceBarrier)
+     * @return 弹出的个数，队列为空时为0
+     *
+     * 一次CAS认领一段连续的读序号，批量越大每条消息分摊的同步开销越小。
+     * 多个消费者可以并发调用，每个消费者拿到的是一段连续的消息。
+     */
+    size_t pop_bulk(Span<T> out, uint64_t limit = UINT64_MAX) {
+#if QUEUE_PERF_STATS
+        const auto start_time = HighResolutionTimer::now();
+        stats_.record_pop_attempt();
+#endif
+
+        uint64_t current_read = read_index_.load(std::memory_order_acquire);
+        size_t count = 0;
+        do {
+            // 只认领已经写入完成的连续前缀
+            const uint64_t current_write = write_index_.load(std::memory_order_acquire);
+            count = 0;
+            const uint64_t end = current_write < limit ? current_write : limit;
+            while (count < out.size() && current_read + count < end &&
+                   slot_ready(current_read + count)) {
+                count++;
+            }
+            if (count == 0) {
+                break;
+            }
+        } while (!read_index_.compare_exchange_weak(
+                     current_read, current_read + count,
+                     std::memory_order_acq_rel, std::memory_order_acquire));
+
+        for (size_t i = 0; i < count; ++i) {
+            T* data = unlink_node(buffer_[(current_read + i) % Capacity]);
+            out[i] = std::move(*data);
+            delete data;
+        }
+
+#if QUEUE_PERF_STATS
+        if (count > 0) {
+            stats_.record_pop_bulk(start_time, count);
+        } else {
+            stats_.record_pop_empty();
+        }
+#endif
+        return count;
+    }
+
     /**
      * @brief 读取指定位置的数据但不移除
      * @brief 读取指定位置的元素(不移除)
@@ -406,17 +737,106 @@ public:
             return std::nullopt;
         }
 
-        size_t current_read = read_index_.load(std::memory_order_acquire);
-        size_t target_index = (current_read + index) % Capacity;
-        T* data = buffer_[target_index].load(std::memory_order_acquire);
+        std::optional<T> result;
+        const uint64_t target = read_index_.load(std::memory_order_acquire) + index;
+        peek(target, [&result](const T& value) { result.emplace(value); });
 
 #if QUEUE_PERF_STATS
-        if (data) {
+        if (result) {
             stats_.record_read_success(start_time);
         }
 #endif
 
-        return data ? std::optional<T>(*data) : std::nullopt;
+        return result;
+    }
+
+    /**
+     * @brief 按序号读取元素(不移除)
+     * @param sequence 消息序号
+     * @return 读取的元素；尚未写入或已被移除时返回nullopt，两者可用 head_sequence() 区分
+     */
+    std::optional<T> read_sequence(uint64_t sequence) {
+#if QUEUE_PERF_STATS
+        const auto start_time = HighResolutionTimer::now();
+        stats_.record_read_attempt();
+#endif
+
+        std::optional<T> result;
+        peek(sequence, [&result](const T& value) { result.emplace(value); });
+
+#if QUEUE_PERF_STATS
+        if (result) {
+            stats_.record_read_success(start_time);
+        }
+#endif
+        return result;
+    }
+
+    /**
+     * @brief 批量读取从指定序号开始的连续元素(不移除)
+     * @param sequence 起始序号
+     * @param out 输出缓冲区，最多读取 out.size() 个
+     * @return 读到的个数，遇到尚未写入或已被移除的序号即停止
+     *
+     * 逐个拷贝槽位中的元素。槽位中保存的是指针，
+     * 元素在环形缓冲区中并不连续，因此无法直接返回指向队列内部的视图。
+     */
+    size_t read_batch(uint64_t sequence, Span<T> out) {
+#if QUEUE_PERF_STATS
+        const auto start_time = HighResolutionTimer::now();
+        stats_.record_read_attempt();
+#endif
+
+        size_t count = 0;
+        while (count < out.size() &&
+               peek(sequence + count, [&out, count](const T& value) { out[count] = value; })) {
+            count++;
+        }
+
+#if QUEUE_PERF_STATS
+        stats_.record_read_batch(start_time, count);
+#endif
+        return count;
+    }
+
+    /**
+     * @brief 原地访问指定序号的消息(不拷贝、不移除)
+     * @param sequence 消息序号
+     * @param visitor 以 T& 调用，可以直接修改消息
+     * @return 消息存在返回true；尚未写入或已被移除返回false，visitor 不会被调用
+     *
+     * 用于同一队列上的多阶段流水线，各阶段通过依赖屏障(SequenceBarrier)依次处理同一条消息。
+     * 访问期间节点不会被消费者取走或释放(见读者登记)，但消息内容的修改需要调用方排序:
+     * 只读的读取器和取走消息的消费者都应依赖最后一个修改消息的阶段，否则可能读到修改了一半的消息。
+     */
+    template<typename Visitor>
+    bool access_sequence(uint64_t sequence, Visitor&& visitor) {
+        return visit(sequence, [&visitor](T& value) { visitor(value); });
+    }
+
+    /**
+     * @brief 设置通知通道，需在生产者启动前调用
+     * @param notifier 通知通道，nullptr 表示不通知；需比队列存活更久或在队列停用后再释放
+     *
+     * 设置后每次成功写入都检查一次消费者是否声明了睡眠(见 QueueNotifier)，
+     * 没有声明时不做系统调用。
+     */
+    void set_notifier(QueueNotifier* notifier) {
+        notifier_ = notifier;
+    }
+
+    /**
+     * @brief 最早仍在队列中的消息序号，小于它的消息已被移除
+     */
+    uint64_t head_sequence() const {
+        return read_index_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 下一条写入的消息将获得的序号，即已写入的消息总数
+     */
+    uint64_t tail_sequence() const {
+        return write_index_.load(std::memory_order_acquire);
     }
 
 #if QUEUE_PERF_STATS
@@ -434,4 +854,148 @@ public:
         stats_.reset();
     }
 #endif
-};
\ No newline at end of file
+
+private:
+    /**
+     * @brief 写序号为 write 时队列是否已满(保留一个空槽位用于区分满/空)
+     */
+    bool is_full(uint64_t write) const {
+        return write - read_index_.load(std::memory_order_acquire) >= Capacity - 1;
+    }
+
+    /**
+     * @brief 写序号为 write 时还能写入的元素个数(保留一个空槽位，与 is_full 一致)
+     */
+    size_t free_slots(uint64_t write) const {
+        const uint64_t used = write - read_index_.load(std::memory_order_acquire);
+        return used < Capacity - 1 ? static_cast<size_t>(Capacity - 1 - used) : 0;
+    }
+
+    /**
+     * @brief 把节点写入已认领序号对应的槽位
+     *
+     * 上一圈的消息可能已被消费者认领但还没清空槽位，此时自旋等待。
+     */
+    void store_slot(uint64_t sequence, T* node) {
+        Slot& slot = buffer_[sequence % Capacity];
+        while (slot.data.load(std::memory_order_acquire) != nullptr) {
+#if QUEUE_PERF_STATS
+            stats_.record_push_spin();
+#endif
+            #if defined(__x86_64__)
+                _mm_pause();
+            #elif defined(__aarch64__)
+                asm volatile("yield");
+            #endif
+        }
+        slot.sequence.store(sequence, std::memory_order_release);
+        slot.data.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief 序号对应的消息是否已写入完成且尚未被取走
+     *
+     * 先读序号再读指针: 生产者在槽位清空之后才更新序号，
+     * 看到新序号时读到的指针只可能是空或新节点，不会是上一圈的旧节点。
+     */
+    bool slot_ready(uint64_t sequence) const {
+        const Slot& slot = buffer_[sequence % Capacity];
+        return slot.sequence.load(std::memory_order_acquire) == sequence &&
+               slot.data.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /**
+     * @brief 认领并取走最旧的元素
+     * @return 取走的节点，队列为空或最旧的元素尚未写入完成时返回nullptr
+     */
+    T* take_oldest() {
+        uint64_t current_read = read_index_.load(std::memory_order_acquire);
+        do {
+            if (current_read == write_index_.load(std::memory_order_acquire) ||
+                !slot_ready(current_read)) {
+                return nullptr;
+            }
+        } while (!read_index_.compare_exchange_weak(
+                     current_read, current_read + 1,
+                     std::memory_order_acq_rel, std::memory_order_acquire));
+        // 认领成功后该槽位归当前消费者独占，生产者要等它清空才会写入下一圈
+        return unlink_node(buffer_[current_read % Capacity]);
+    }
+
+    /**
+     * @brief 取下槽位中的节点，等正在访问它的观察者离开后交给调用方独占
+     * @return 取下的节点
+     */
+    T* unlink_node(Slot& slot) {
+        T* data = slot.data.exchange(nullptr, std::memory_order_seq_cst);
+        wait_for_readers(slot);
+        return data;
+    }
+
+    /**
+     * @brief 等待槽位上登记的观察者全部离开
+     *
+     * 调用前槽位中的指针已被换掉(seq_cst)。观察者先登记(seq_cst)再读指针(seq_cst)，
+     * 因此要么它读到的已是新指针，不会访问旧节点；要么这里能看到它的登记并等待。
+     * 观察者离开时的 release 与这里的读取同步，其对旧节点的访问先于调用方移动或释放节点。
+     */
+    void wait_for_readers(const Slot& slot) {
+        while (slot.readers.load(std::memory_order_seq_cst) != 0) {
+#if QUEUE_PERF_STATS
+            stats_.record_reader_wait();
+#endif
+            #if defined(__x86_64__)
+                _mm_pause();
+            #elif defined(__aarch64__)
+                asm volatile("yield");
+            #endif
+        }
+    }
+
+    /**
+     * @brief 不移除地读取指定序号的消息
+     * @param visitor 读到时以 const T& 调用
+     * @return 读到有效消息返回true
+     */
+    template<typename Visitor>
+    bool peek(uint64_t sequence, Visitor&& visitor) const {
+        return visit(sequence, [&visitor](const T& value) { visitor(value); });
+    }
+
+    /**
+     * @brief 在读者登记的保护下访问指定序号的节点
+     * @param visitor 以 T& 调用，调用期间节点不会被移动或释放
+     * @return 消息存在返回true；尚未写入或已被移除返回false，visitor 不会被调用
+     */
+    template<typename Visitor>
+    bool visit(uint64_t sequence, Visitor&& visitor) const {
+        const Slot& slot = buffer_[sequence % Capacity];
+        // 序号不符时不必登记，避免空读时在槽位上做原子写
+        if (slot.sequence.load(std::memory_order_acquire) != sequence) {
+            return false;
+        }
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        T* data = slot.data.load(std::memory_order_seq_cst);
+        // 读到指针后再检查一次序号，排除下一圈已经写入的节点
+        const bool valid = data != nullptr &&
+                           slot.sequence.load(std::memory_order_acquire) == sequence;
+        if (valid) {
+            visitor(*data);
+        }
+        slot.readers.fetch_sub(1, std::memory_order_release);
+        return valid;
+    }
+
+    /**
+     * @brief 丢弃队列中最旧的元素(不计入pop统计)
+     * @return 丢弃成功返回true，队列为空或被消费者抢先取走返回false
+     */
+    bool discard_oldest() {
+        T* data = take_oldest();
+        if (!data) {
+            return false;
+        }
+        delete data;
+        return true;
+    }
+};
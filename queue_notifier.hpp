@@ -0,0 +1,166 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+template<typename T, size_t Capacity>
+class NBQueue;
+
+/**
+ * @brief 队列的 eventfd 通知通道，让消费者可以在 epoll 中与套接字、定时器一起等待队列
+ *
+ * 消费者没有声明要睡眠时，生产者写入队列不做任何系统调用，只多读一次标志位；
+ * 消费者准备进入 epoll_wait 前调用 prepare_to_sleep() 声明睡眠，此后第一个写入的生产者
+ * 清除声明并写一次 eventfd，同一次睡眠期间的其他写入不再通知，唤醒被合并。
+ *
+ * 事件循环中的用法:
+ *   QueueNotifier notifier;
+ *   queue.set_notifier(&notifier);          // 生产者启动前设置
+ *   epoll_ctl(epfd, EPOLL_CTL_ADD, notifier.fd(), &ev);   // EPOLLIN
+ *   for (;;) {
+ *       while (auto data = queue.pop()) handle(*data);
+ *       if (!notifier.prepare_to_sleep(queue)) continue;  // 声明后发现有数据，不睡
+ *       int n = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+ *       notifier.wake();                      // 无论因何醒来都撤销声明
+ *       for (...) if (events[i].data.fd == notifier.fd()) notifier.consume();
+ *   }
+ * 一个事件循环可以为多个队列各注册一个通知通道。
+ */
+class QueueNotifier {
+public:
+    /**
+     * @brief 创建 eventfd
+     * @throw std::system_error eventfd 创建失败
+     */
+    QueueNotifier() {
+        fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+    }
+
+    ~QueueNotifier() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    QueueNotifier(const QueueNotifier&) = delete;
+    QueueNotifier& operator=(const QueueNotifier&) = delete;
+
+    /**
+     * @brief 注册到 epoll 的文件描述符，可读表示有新消息
+     */
+    int fd() const {
+        return fd_;
+    }
+
+    /**
+     * @brief 生产者写入消息后调用，只有消费者声明了睡眠时才写 eventfd
+     *
+     * 写入消息(对读写索引的CAS)与读取睡眠标志之间用全屏障隔开，与 prepare_to_sleep()
+     * 中声明睡眠与检查队列之间的屏障配对，保证不会出现"消费者看到队列为空、生产者看到没人睡眠"。
+     */
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!sleeping_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        // 多个生产者同时看到声明时只有一个写 eventfd
+        if (!sleeping_.exchange(false, std::memory_order_acq_rel)) {
+            return;
+        }
+        const uint64_t one = 1;
+        // eventfd 计数器溢出前一直可写，非阻塞写失败时事件已经处于可读状态，可以忽略
+        [[maybe_unused]] const ssize_t written = ::write(fd_, &one, sizeof(one));
+#if QUEUE_PERF_STATS
+        wakeups_++;
+#endif
+    }
+
+    /**
+     * @brief 消费者声明即将睡眠，随后再检查一次是否有数据
+     * @param is_empty 返回是否仍然没有可处理数据的检查函数
+     * @return 可以睡眠返回true；检查发现有数据时撤销声明并返回false
+     */
+    template<typename IsEmpty>
+    bool prepare_to_sleep_if(IsEmpty&& is_empty) {
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!is_empty()) {
+            sleeping_.store(false, std::memory_order_relaxed);
+#if QUEUE_PERF_STATS
+            aborted_sleeps_++;
+#endif
+            return false;
+        }
+#if QUEUE_PERF_STATS
+        sleeps_++;
+#endif
+        return true;
+    }
+
+    /**
+     * @brief 从队列中取走消息的消费者使用的便捷形式: 队列中没有消息时可以睡眠
+     *
+     * 只读的读取器应使用 prepare_to_sleep_if()，比较自己的读取位置与 tail_sequence()。
+     */
+    template<typename T, size_t Capacity>
+    bool prepare_to_sleep(const NBQueue<T, Capacity>& queue) {
+        return prepare_to_sleep_if([&queue]() {
+            return queue.head_sequence() == queue.tail_sequence();
+        });
+    }
+
+    /**
+     * @brief 消费者醒来后撤销睡眠声明(无论是否因本通道醒来)
+     */
+    void wake() {
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief fd 可读时清空 eventfd 计数器
+     * @return 自上次清空以来合并的通知次数
+     */
+    uint64_t consume() {
+        uint64_t count = 0;
+        if (::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+            return 0;
+        }
+        return count;
+    }
+
+#if QUEUE_PERF_STATS
+    std::string get_stats() const {
+        std::stringstream ss;
+        ss << "通知通道统计:\n"
+           << "睡眠次数: " << sleeps_.load() << "\n"
+           << "放弃睡眠次数: " << aborted_sleeps_.load() << "\n"
+           << "唤醒次数: " << wakeups_.load() << "\n";
+        return ss.str();
+    }
+
+    void reset_stats() {
+        sleeps_ = 0;
+        aborted_sleeps_ = 0;
+        wakeups_ = 0;
+    }
+#endif
+
+private:
+    int fd_ = -1;                                  // eventfd
+    alignas(64) std::atomic<bool> sleeping_{false};   // 消费者已声明睡眠，等待通知
+
+#if QUEUE_PERF_STATS
+    alignas(64) std::atomic<size_t> sleeps_{0};   // 声明后真正进入睡眠的次数
+    std::atomic<size_t> aborted_sleeps_{0};       // 声明后发现有数据而放弃的次数
+    std::atomic<size_t> wakeups_{0};              // 写 eventfd 的次数
+#endif
+};
@@ -0,0 +1,375 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "timer.hpp"
+#include "backoff.hpp"
+#include "thread_options.hpp"
+#include "lock_free_queue_reader.hpp"
+
+/**
+ * @brief 读取器执行器中一个工作线程的统计
+ */
+#if QUEUE_READER_PERF_STATS
+class ReaderWorkerStats {
+public:
+    void record_round(size_t messages) {
+        rounds++;
+        this->messages += messages;
+    }
+
+    void record_idle_round() {
+        idle_rounds++;
+    }
+
+    void record_budget_exhausted() {
+        budget_exhausted++;
+    }
+
+    void record_backoff(uint64_t ticks) {
+        backoff.record_pause(ticks);
+    }
+
+    void record_idle_sleep() {
+        idle_sleeps++;
+    }
+
+    void record_wake(uint64_t ticks) {
+        backoff.record_wake(ticks);
+    }
+
+    void record_arrival_interval(uint64_t ticks) {
+        backoff.record_interval(ticks);
+    }
+
+    std::string get_stats() const {
+        std::stringstream ss;
+        const auto busy = rounds.load();
+        const auto msgs = messages.load();
+        ss << "有消息的轮询轮数: " << busy << "\n";
+        ss << "空闲轮询轮数: " << idle_rounds.load() << "\n";
+        ss << "处理消息数: " << msgs << "\n";
+        if (busy > 0) {
+            ss << "每轮平均消息数: " << static_cast<double>(msgs) / busy << "\n";
+        }
+        ss << "用完配额次数: " << budget_exhausted.load() << "\n";
+        ss << "空闲休眠次数: " << idle_sleeps.load() << "\n";
+        ss << backoff.get_stats();
+        return ss.str();
+    }
+
+    void reset() {
+        rounds = 0;
+        idle_rounds = 0;
+        messages = 0;
+        budget_exhausted = 0;
+        idle_sleeps = 0;
+        backoff.reset();
+    }
+
+private:
+    std::atomic<size_t> rounds{0};              // 至少一个读取器有进展的轮数
+    std::atomic<size_t> idle_rounds{0};         // 所有读取器都没有消息的轮数
+    std::atomic<uint64_t> messages{0};          // 处理的消息总数
+    std::atomic<size_t> budget_exhausted{0};    // 读取器用完单轮配额被切走的次数
+    std::atomic<size_t> idle_sleeps{0};         // 回退达到上限后让出CPU的次数
+    BackoffStats backoff;                       // 全部空闲时的回退
+};
+#endif
+
+/**
+ * @brief 在固定大小的线程池上运行大量读取器
+ *
+ * 每个 LockFreeQueueReader 自带一个观察者线程，读取器数量远多于CPU核数时大部分时间在空转。
+ * 执行器把读取器分给少数工作线程，每个工作线程按固定顺序轮询自己负责的读取器:
+ * - 读取器按被观察队列的地址排序后按段均分，同一队列的读取器(除落在分段边界上的以外)
+ *   在同一线程上相邻轮询，共享队列槽位所在的缓存行；同一队列内保持添加顺序，
+ *   按上下游顺序添加的 depends_on() 阶段在同一轮中依次推进
+ * - 每轮每个读取器最多处理 poll_budget 条消息，繁忙的读取器不会饿死同线程的其他读取器
+ * - 只有一整轮所有读取器都没有消息时才回退等待(AdaptiveBackoff)，有进展时立即继续
+ * - 回退达到单次上限(连续空闲已久)后不再自旋，每轮空闲休眠 idle_sleep(默认50us)让出CPU，
+ *   代价是安静期之后的第一条消息最多多等一次休眠；set_idle_sleep(0) 改为只 yield
+ *
+ * 用法:
+ *   ReaderExecutor executor(2);
+ *   for (auto& reader : readers) executor.add(*reader);   // 不再调用 reader->start()
+ *   executor.start();
+ *   ...
+ *   executor.stop();
+ * 读取器需比执行器存活更久，或在销毁读取器之前 stop()。
+ */
+class ReaderExecutor {
+public:
+    static constexpr size_t DEFAULT_POLL_BUDGET = 256;   // 每轮每个读取器最多处理的消息数
+    static constexpr auto DEFAULT_IDLE_SLEEP = std::chrono::microseconds(50);  // 回退达到上限后每轮空闲的休眠时长
+
+    /**
+     * @param threads 工作线程数，至少为1；实际启动的线程数不超过读取器数
+     */
+    explicit ReaderExecutor(size_t threads)
+        : threads_(threads > 0 ? threads : 1) {}
+
+    ~ReaderExecutor() {
+        stop();
+        if (!started_) {
+            // 添加后没有启动，把读取器交还给调用方
+            for (auto& entry : entries_) {
+                entry.release(entry.reader);
+            }
+        }
+    }
+
+    ReaderExecutor(const ReaderExecutor&) = delete;
+    ReaderExecutor& operator=(const ReaderExecutor&) = delete;
+
+    /**
+     * @brief 添加读取器，需在start()之前调用
+     * @param reader 未单独 start() 的读取器
+     * @throw std::logic_error 执行器已启动，或读取器已在运行(已 start() 或已添加到执行器)
+     */
+    template<typename Derived, typename T, size_t Capacity>
+    void add(LockFreeQueueReader<Derived, T, Capacity>& reader) {
+        using Reader = LockFreeQueueReader<Derived, T, Capacity>;
+        if (started_) {
+            throw std::logic_error("执行器已启动，不能再添加读取器");
+        }
+        if (reader.running_.exchange(true)) {
+            throw std::logic_error("读取器已在运行，不能再添加到执行器");
+        }
+        Entry entry;
+        entry.reader = &reader;
+        entry.queue = reader.queue_address();
+        entry.begin = [](void* r) {
+            static_cast<Reader*>(r)->begin_reading();
+        };
+        entry.poll = [](void* r, size_t budget) {
+            return static_cast<Reader*>(r)->poll(budget);
+        };
+        entry.release = [](void* r) {
+            static_cast<Reader*>(r)->running_.store(false);
+        };
+        entries_.push_back(entry);
+    }
+
+    /**
+     * @brief 设置每轮每个读取器最多处理的消息数，需在start()之前调用
+     * @param budget 至少为1，越小越公平，越大每轮切换读取器的开销越小
+     */
+    void set_poll_budget(size_t budget) {
+        poll_budget_ = budget > 0 ? budget : 1;
+    }
+
+    /**
+     * @brief 设置回退达到上限后每轮空闲的休眠时长，需在start()之前调用
+     * @param sleep 0表示只让出CPU(yield)不休眠，越长空闲时越省CPU，安静期后的唤醒延迟越大
+     */
+    void set_idle_sleep(std::chrono::nanoseconds sleep) {
+        idle_sleep_ = sleep;
+    }
+
+    /**
+     * @brief 分配读取器并启动工作线程
+     * @param options 每个工作线程的选项，按下标对应；不足时其余线程使用默认选项
+     * @return 各工作线程的设置结果，等所有线程完成设置后才返回；已启动过时返回空
+     */
+    std::vector<ThreadSetupResult> start(const std::vector<ThreadOptions>& options = {}) {
+        if (started_ || running_.exchange(true)) {
+            return {};
+        }
+        started_ = true;
+        assign();
+        // 与 LockFreeQueueReader::start 一致，返回前确定所有读取器的起始位置
+        for (auto& entry : entries_) {
+            entry.begin(entry.reader);
+        }
+
+        std::vector<ThreadSetupResult> results(workers_.size());
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            const ThreadOptions worker_options = i < options.size() ? options[i] : ThreadOptions{};
+            Worker& worker = *workers_[i];
+            std::promise<ThreadSetupResult> setup;
+            auto setup_result = setup.get_future();
+            worker.thread = std::thread([this, &worker, worker_options, setup = std::move(setup)]() mutable {
+                setup.set_value(apply_thread_options(worker_options));
+                run(worker);
+            });
+            results[i] = setup_result.get();
+        }
+        return results;
+    }
+
+    /**
+     * @brief 停止所有工作线程，执行器不能再次启动
+     *
+     * 停止后读取器可以单独 start() 或添加到新的执行器，统计信息保留。
+     */
+    void stop() {
+        if (!running_.exchange(false)) {
+            return;
+        }
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+        for (auto& entry : entries_) {
+            entry.release(entry.reader);
+        }
+    }
+
+    size_t reader_count() const {
+        return entries_.size();
+    }
+
+    /**
+     * @brief 实际启动的工作线程数，启动前为0
+     */
+    size_t worker_count() const {
+        return workers_.size();
+    }
+
+#if QUEUE_READER_PERF_STATS
+    /**
+     * @brief 获取各工作线程的统计信息
+     */
+    std::string get_stats() const {
+        std::stringstream ss;
+        ss << "读取器执行器统计:\n";
+        ss << "读取器数: " << entries_.size() << ", 工作线程数: " << workers_.size() << "\n";
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            ss << "工作线程 " << i << " (" << workers_[i]->entries.size() << " 个读取器):\n"
+               << workers_[i]->stats.get_stats();
+        }
+        return ss.str();
+    }
+
+    void reset_stats() {
+        for (auto& worker : workers_) {
+            worker->stats.reset();
+        }
+    }
+#endif
+
+private:
+    /**
+     * @brief 类型擦除后的读取器，轮询时不经过虚函数表
+     */
+    struct Entry {
+        void* reader = nullptr;
+        const void* queue = nullptr;                 // 被观察的队列，用于排序
+        void (*begin)(void*) = nullptr;
+        size_t (*poll)(void*, size_t) = nullptr;
+        void (*release)(void*) = nullptr;
+    };
+
+    struct Worker {
+        std::vector<Entry> entries;                  // 按轮询顺序排列
+        std::thread thread;
+#if QUEUE_READER_PERF_STATS
+        ReaderWorkerStats stats;
+#endif
+    };
+
+    size_t threads_;                                 // 请求的工作线程数
+    size_t poll_budget_ = DEFAULT_POLL_BUDGET;       // 每轮每个读取器的配额
+    std::chrono::nanoseconds idle_sleep_ = DEFAULT_IDLE_SLEEP;  // 回退达到上限后的休眠时长
+    std::atomic<bool> running_{false};
+    bool started_ = false;                           // 已启动过
+    std::vector<Entry> entries_;                     // 所有读取器，按添加顺序
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    /**
+     * @brief 按队列地址稳定排序后，把读取器分成尽量均匀的连续段
+     */
+    void assign() {
+        std::vector<Entry> ordered = entries_;
+        std::stable_sort(ordered.begin(), ordered.end(), [](const Entry& a, const Entry& b) {
+            return std::less<const void*>()(a.queue, b.queue);
+        });
+
+        workers_.clear();
+        const size_t count = std::min(threads_, ordered.size());
+        size_t next = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const size_t share = (ordered.size() - next) / (count - i);
+            auto worker = std::make_unique<Worker>();
+            worker->entries.assign(ordered.begin() + next, ordered.begin() + next + share);
+            next += share;
+            workers_.push_back(std::move(worker));
+        }
+    }
+
+    /**
+     * @brief 工作线程主函数: 一轮依次轮询所有读取器，整轮都空闲时才回退，回退达到上限后休眠
+     */
+    void run(Worker& worker) {
+        const size_t budget = poll_budget_;
+        const std::chrono::nanoseconds idle_sleep = idle_sleep_;
+        AdaptiveBackoff backoff;     // 回退状态
+        bool was_idle = false;       // 上一轮是否全部空闲
+
+        while (running_.load(std::memory_order_relaxed)) {
+            size_t round = 0;
+            for (auto& entry : worker.entries) {
+                const size_t count = entry.poll(entry.reader, budget);
+#if QUEUE_READER_PERF_STATS
+                if (count >= budget) {
+                    worker.stats.record_budget_exhausted();
+                }
+#endif
+                round += count;
+            }
+
+            if (round > 0) {
+                [[maybe_unused]] const uint64_t wake_ticks = backoff.on_progress(round);
+#if QUEUE_READER_PERF_STATS
+                worker.stats.record_round(round);
+                if (wake_ticks > 0) {
+                    worker.stats.record_wake(wake_ticks);
+                }
+#endif
+                was_idle = false;
+                continue;
+            }
+
+#if QUEUE_READER_PERF_STATS
+            worker.stats.record_idle_round();
+#endif
+            if (!was_idle) {
+                // 第一轮空闲，再轮询一遍
+                was_idle = true;
+                continue;
+            }
+
+            if (backoff.saturated()) {
+                // 连续空闲已久，自旋回退到上限仍没有消息，让出CPU直到有进展
+#if QUEUE_READER_PERF_STATS
+                worker.stats.record_idle_sleep();
+#endif
+                if (idle_sleep.count() > 0) {
+                    std::this_thread::sleep_for(idle_sleep);
+                } else {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+
+            // 按消息到达间隔自适应的指数回退
+            [[maybe_unused]] const uint64_t pause_ticks = backoff.pause();
+#if QUEUE_READER_PERF_STATS
+            worker.stats.record_backoff(pause_ticks);
+            worker.stats.record_arrival_interval(backoff.interval_ticks());
+#endif
+        }
+    }
+};
@@ -0,0 +1,340 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <future>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "timer.hpp"
+#include "backoff.hpp"
+#include "thread_options.hpp"
+#include "queue.hpp"
+
+/**
+ * @brief 按分片的路由生产者统计
+ */
+#if QUEUE_PRODUCER_PERF_STATS
+class ShardStats {
+public:
+    void record_routed() {
+        routed++;
+    }
+
+    void record_published() {
+        published++;
+    }
+
+    void record_staged(size_t depth) {
+        staged++;
+        size_t current_max = max_staging_depth.load();
+        while (depth > current_max &&
+               !max_staging_depth.compare_exchange_weak(current_max, depth));
+    }
+
+    void record_queue_full() {
+        queue_full_count++;
+    }
+
+    void record_staging_full() {
+        staging_full_count++;
+    }
+
+    std::string get_stats() const {
+        std::stringstream ss;
+        ss << "路由消息数: " << routed.load()
+           << ", 发布数: " << published.load()
+           << ", 进入暂存数: " << staged.load()
+           << ", 最大暂存深度: " << max_staging_depth.load()
+           << ", 队列满次数: " << queue_full_count.load()
+           << ", 暂存满次数: " << staging_full_count.load() << "\n";
+        return ss.str();
+    }
+
+    void reset() {
+        routed = 0;
+        published = 0;
+        staged = 0;
+        max_staging_depth = 0;
+        queue_full_count = 0;
+        staging_full_count = 0;
+    }
+
+private:
+    std::atomic<size_t> routed{0};              // 路由到该分片的消息数
+    std::atomic<size_t> published{0};           // 成功写入该分片队列的消息数
+    std::atomic<size_t> staged{0};              // 因队列满进入暂存缓冲区的消息数
+    std::atomic<size_t> max_staging_depth{0};   // 暂存缓冲区的最大深度
+    std::atomic<size_t> queue_full_count{0};    // 写入队列失败次数
+    std::atomic<size_t> staging_full_count{0};  // 暂存缓冲区满、生成暂停的次数
+};
+#endif
+
+/**
+ * @brief 按键路由到多个队列的生产者
+ * @tparam T 数据类型
+ * @tparam Capacity 每个分片队列的容量
+ * @tparam Generator 数据生成器类型，签名为 T()
+ * @tparam KeyOf 键提取器类型，签名为 Key(const T&)，例如取合约编号
+ * @tparam Hash 键的哈希函数类型，默认为 std::hash<Key>
+ *
+ * 每条消息按 Hash(KeyOf(msg)) % 分片数 路由到对应队列，同一键的消息始终进入同一分片，
+ * 保证按键有序，同时各分片可以由不同的消费者并行处理。
+ *
+ * 每个分片有一个本地暂存缓冲区: 分片队列满时消息先进入暂存区，之后按顺序补发，
+ * 其他分片不受影响。只有某个分片的暂存区也满了，且新消息恰好属于该分片时，
+ * 生成才会暂停(保留这条消息，不丢弃)，直到该分片腾出空间。
+ */
+template<typename T, size_t Capacity, typename Generator, typename KeyOf,
+         typename Hash = std::hash<std::decay_t<std::invoke_result_t<KeyOf&, const T&>>>>
+class RoutingQueueProducer {
+private:
+    static constexpr size_t DEFAULT_STAGING_CAPACITY = 1024;  // 每个分片的默认暂存容量
+
+    /**
+     * @brief 单个分片: 目标队列和本地暂存环形缓冲区
+     */
+    struct Shard {
+        NBQueue<T, Capacity>* queue;   // 分片队列
+        std::vector<T> staging;        // 暂存缓冲区
+        size_t head = 0;               // 最早暂存消息的位置
+        size_t count = 0;              // 暂存消息数
+
+        bool staging_full() const { return count == staging.size(); }
+    };
+
+    std::vector<Shard> shards_;                // 所有分片
+    std::atomic<bool> running_{false};         // 运行状态标志
+    std::thread producer_thread_;              // 生产者线程
+    Generator data_generator_;                 // 数据生成器
+    KeyOf key_of_;                             // 键提取器
+    Hash hash_;                                // 键哈希
+    std::optional<T> pending_;                 // 所属分片暂存区已满、尚未被接收的消息，stop()后保留
+    size_t pending_shard_ = 0;                 // pending_ 所属分片
+
+#if QUEUE_PRODUCER_PERF_STATS
+    std::vector<ShardStats> stats_;            // 各分片统计
+#endif
+
+    size_t shard_of(const T& data) {
+        return hash_(key_of_(data)) % shards_.size();
+    }
+
+    /**
+     * @brief 按顺序补发某个分片暂存的消息，直到队列再次满
+     * @return 本次补发的条数
+     */
+    size_t flush(size_t index) {
+        Shard& shard = shards_[index];
+        size_t flushed = 0;
+        while (shard.count > 0) {
+            if (!shard.queue->try_push(shard.staging[shard.head])) {
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_[index].record_queue_full();
+#endif
+                break;
+            }
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_[index].record_published();
+#endif
+            shard.head = (shard.head + 1) % shard.staging.size();
+            shard.count--;
+            flushed++;
+        }
+        return flushed;
+    }
+
+    /**
+     * @brief 把消息交给所属分片: 暂存区为空时直接写入队列，否则追加到暂存区末尾
+     * @return 消息被接收返回true；暂存区已满返回false，消息原样保留在data中
+     */
+    bool route(size_t index, T& data) {
+        Shard& shard = shards_[index];
+        if (shard.count == 0) {
+            if (shard.queue->try_push(data)) {
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_[index].record_published();
+#endif
+                return true;
+            }
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_[index].record_queue_full();
+#endif
+        }
+        if (shard.staging_full()) {
+#if QUEUE_PRODUCER_PERF_STATS
+            stats_[index].record_staging_full();
+#endif
+            return false;
+        }
+        shard.staging[(shard.head + shard.count) % shard.staging.size()] = std::move(data);
+        shard.count++;
+#if QUEUE_PRODUCER_PERF_STATS
+        stats_[index].record_staged(shard.count);
+#endif
+        return true;
+    }
+
+    /**
+     * @brief 生产者线程主函数
+     */
+    void produce() {
+        AdaptiveBackoff backoff;         // 回退状态
+
+        while (running_.load(std::memory_order_relaxed)) {
+            size_t progress = 0;
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                progress += flush(i);
+            }
+
+            if (!pending_) {
+                pending_.emplace(data_generator_());
+                pending_shard_ = shard_of(*pending_);
+#if QUEUE_PRODUCER_PERF_STATS
+                stats_[pending_shard_].record_routed();
+#endif
+            }
+            if (route(pending_shard_, *pending_)) {
+                pending_.reset();
+                progress++;
+            }
+
+            if (progress > 0) {
+                backoff.on_progress(progress);
+                continue;
+            }
+
+            // 没有任何进展: 被阻塞的分片队列满且暂存区满
+            backoff.pause();
+        }
+    }
+
+public:
+    /**
+     * @brief 构造函数
+     * @param queues 各分片的目标队列，分片编号即下标
+     * @param data_generator 数据生成器
+     * @param key_of 键提取器
+     * @param staging_capacity 每个分片的暂存缓冲区容量
+     * @param hash 键哈希函数
+     * @throw std::invalid_argument queues 为空
+     */
+    RoutingQueueProducer(
+        const std::vector<NBQueue<T, Capacity>*>& queues,
+        Generator data_generator,
+        KeyOf key_of,
+        size_t staging_capacity = DEFAULT_STAGING_CAPACITY,
+        Hash hash = Hash())
+        : data_generator_(std::move(data_generator))
+        , key_of_(std::move(key_of))
+        , hash_(std::move(hash))
+#if QUEUE_PRODUCER_PERF_STATS
+        , stats_(queues.size())
+#endif
+    {
+        if (queues.empty()) {
+            throw std::invalid_argument("路由生产者至少需要一个分片队列");
+        }
+        shards_.reserve(queues.size());
+        for (auto* queue : queues) {
+            shards_.push_back(Shard{queue, std::vector<T>(staging_capacity > 0 ? staging_capacity : 1)});
+        }
+    }
+
+    /**
+     * @brief 析构函数，确保线程安全停止
+     */
+    ~RoutingQueueProducer() {
+        stop();
+    }
+
+    RoutingQueueProducer(const RoutingQueueProducer&) = delete;
+    RoutingQueueProducer& operator=(const RoutingQueueProducer&) = delete;
+
+    /**
+     * @brief 启动生产者
+     * @param options 线程选项(绑核、SCHED_FIFO优先级、线程名)
+     * @return 线程选项的应用结果，语义同 LockFreeQueueProducer::start
+     */
+    ThreadSetupResult start(const ThreadOptions& options = {}) {
+        if (running_.exchange(true)) {
+            return {};
+        }
+        std::promise<ThreadSetupResult> setup;
+        auto setup_result = setup.get_future();
+        producer_thread_ = std::thread([this, options, setup = std::move(setup)]() mutable {
+            setup.set_value(apply_thread_options(options));
+            produce();
+        });
+        return setup_result.get();
+    }
+
+    /**
+     * @brief 停止生产者
+     *
+     * 停止时仍在暂存区中的消息，以及因暂存区满而暂停生成时持有的那条消息，都保留在生产者内，
+     * 可通过 staged_count() 和 has_pending() 查看，再次start()后会继续补发。
+     */
+    void stop() {
+        if (running_.exchange(false)) {
+            if (producer_thread_.joinable()) {
+                producer_thread_.join();
+            }
+        }
+    }
+
+    /**
+     * @brief 分片数
+     */
+    size_t shard_count() const {
+        return shards_.size();
+    }
+
+    /**
+     * @brief 某个分片暂存区中尚未发布的消息数，需在stop()之后读取
+     */
+    size_t staged_count(size_t shard) const {
+        return shards_[shard].count;
+    }
+
+    /**
+     * @brief 是否持有一条因所属分片暂存区已满而尚未被接收的消息，需在stop()之后读取
+     */
+    bool has_pending() const {
+        return pending_.has_value();
+    }
+
+#if QUEUE_PRODUCER_PERF_STATS
+    /**
+     * @brief 获取各分片的性能统计信息
+     */
+    std::string get_stats() const {
+        std::stringstream ss;
+        ss << "路由生产者性能统计:\n";
+        for (size_t i = 0; i < stats_.size(); ++i) {
+            ss << "分片 " << i << ": " << stats_[i].get_stats();
+        }
+        return ss.str();
+    }
+
+    /**
+     * @brief 重置统计信息
+     */
+    void reset_stats() {
+        for (auto& stats : stats_) {
+            stats.reset();
+        }
+    }
+#endif
+};
+
+// 推导指引: 从队列列表和可调用对象推导出模板参数
+template<typename T, size_t Capacity, typename Generator, typename KeyOf>
+RoutingQueueProducer(const std::vector<NBQueue<T, Capacity>*>&, Generator, KeyOf)
+    -> RoutingQueueProducer<T, Capacity, Generator, KeyOf>;
+
+template<typename T, size_t Capacity, typename Generator, typename KeyOf>
+RoutingQueueProducer(const std::vector<NBQueue<T, Capacity>*>&, Generator, KeyOf, size_t)
+    -> RoutingQueueProducer<T, Capacity, Generator, KeyOf>;
@@ -0,0 +1,122 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "timer.hpp"
+
+/**
+ * @brief 生产者发送计划
+ *
+ * 决定生产者每条消息的"预定发送时间"(计数器原始值):
+ * - Saturate: 闭环模式，不设预定时间，尽可能快地发送(原有行为)
+ * - FixedRate: 开环模式，按固定间隔发送
+ * - Poisson: 开环模式，按泊松过程发送(间隔服从指数分布)
+ * - Replay: 开环模式，按录制的到达间隔依次发送，到末尾后从头循环
+ *
+ * 开环模式下预定时间只按计划推进，不受队列满或发送变慢影响；
+ * 延迟从预定时间算起，避免协调遗漏(coordinated omission)把背压期间的排队时间藏起来。
+ */
+class SendSchedule {
+public:
+    enum class Mode {
+        Saturate,    // 闭环，全速发送
+        FixedRate,   // 开环，固定速率
+        Poisson,     // 开环，泊松到达
+        Replay,      // 开环，按录制的到达间隔
+    };
+
+    /**
+     * @brief 闭环全速发送
+     */
+    static SendSchedule saturate() {
+        return SendSchedule(Mode::Saturate, 0.0, 0);
+    }
+
+    /**
+     * @brief 固定速率发送
+     * @param rate_per_sec 每秒发送的消息数
+     */
+    static SendSchedule fixed_rate(double rate_per_sec) {
+        return SendSchedule(Mode::FixedRate, rate_per_sec, 0);
+    }
+
+    /**
+     * @brief 泊松到达发送
+     * @param rate_per_sec 平均每秒发送的消息数
+     * @param seed 随机数种子，便于复现同一到达序列
+     */
+    static SendSchedule poisson(double rate_per_sec, uint64_t seed = std::random_device{}()) {
+        return SendSchedule(Mode::Poisson, rate_per_sec, seed);
+    }
+
+    /**
+     * @brief 按录制的到达间隔发送
+     * @param intervals_ticks 每条消息到下一条消息的间隔(本机计数器原始值)，已按回放倍速缩放
+     *
+     * 间隔序列用完后从头循环；通常由 TrafficCapture::schedule() 生成。
+     */
+    static SendSchedule replay(std::shared_ptr<const std::vector<double>> intervals_ticks) {
+        SendSchedule schedule(Mode::Replay, 0.0, 0);
+        if (intervals_ticks && !intervals_ticks->empty()) {
+            double total = 0;
+            for (double interval : *intervals_ticks) {
+                total += interval;
+            }
+            const double ticks_per_sec = 1.0 / HighResolutionTimer::to_sec(1);
+            schedule.mean_interval_ticks_ = total / intervals_ticks->size();
+            schedule.rate_per_sec_ = total > 0 ? ticks_per_sec * intervals_ticks->size() / total : 0;
+            schedule.intervals_ = std::move(intervals_ticks);
+        }
+        return schedule;
+    }
+
+    Mode mode() const { return mode_; }
+    double rate() const { return rate_per_sec_; }
+    bool is_open_loop() const { return mode_ != Mode::Saturate; }
+
+    /**
+     * @brief 从指定时间开始计划
+     * @param start_ticks 第一条消息的预定发送时间
+     */
+    void begin(uint64_t start_ticks) {
+        next_ticks_ = static_cast<double>(start_ticks);
+        replay_index_ = 0;
+    }
+
+    /**
+     * @brief 取出下一条消息的预定发送时间并推进计划
+     * @return 预定发送时间(计数器原始值)
+     */
+    uint64_t next() {
+        const auto intended = static_cast<uint64_t>(next_ticks_);
+        if (mode_ == Mode::Poisson) {
+            next_ticks_ += interval_dist_(rng_) * mean_interval_ticks_;
+        } else if (mode_ == Mode::Replay && intervals_) {
+            next_ticks_ += (*intervals_)[replay_index_];
+            replay_index_ = (replay_index_ + 1) % intervals_->size();
+        } else {
+            next_ticks_ += mean_interval_ticks_;
+        }
+        return intended;
+    }
+
+private:
+    Mode mode_;
+    double rate_per_sec_;
+    double mean_interval_ticks_{0};               // 平均发送间隔(计数器原始值)
+    double next_ticks_{0};                        // 下一条消息的预定时间，用浮点累加避免取整漂移
+    std::mt19937_64 rng_;
+    std::exponential_distribution<double> interval_dist_{1.0};
+    std::shared_ptr<const std::vector<double>> intervals_;  // Replay模式的到达间隔序列
+    size_t replay_index_{0};                                // Replay模式下一个间隔的下标
+
+    SendSchedule(Mode mode, double rate_per_sec, uint64_t seed)
+        : mode_(mode), rate_per_sec_(rate_per_sec), rng_(seed) {
+        if ((mode_ == Mode::FixedRate || mode_ == Mode::Poisson) && rate_per_sec_ > 0) {
+            const double ticks_per_sec = 1.0 / HighResolutionTimer::to_sec(1);
+            mean_interval_ticks_ = ticks_per_sec / rate_per_sec_;
+        }
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 阶段进度: 某个阶段已经处理完的消息数，即它下一条要处理的消息序号
+ *
+ * 由所属阶段的线程单独写入，下游阶段读取。独占一个缓存行，避免各阶段的进度互相伪共享。
+ */
+struct alignas(64) SequenceCursor {
+    std::atomic<uint64_t> value{0};
+
+    uint64_t load() const {
+        return value.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief 发布进度，之前对消息的修改对读到该进度的下游可见
+     */
+    void publish(uint64_t sequence) {
+        value.store(sequence, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief 依赖屏障: 只允许处理所有上游阶段都已处理完的消息
+ *
+ * 用于在同一个环形队列上搭建多阶段流水线(例如 解码 → 补全 → 风控 → 发布):
+ * 各阶段是依赖前一阶段的读取器，原地修改同一条消息，不必在队列之间拷贝和转发。
+ * 最后取走消息的消费者依赖最后一个阶段，保证消息在所有阶段处理完之前不会被移除。
+ */
+class SequenceBarrier {
+public:
+    /**
+     * @brief 添加一个上游阶段
+     */
+    void add(const SequenceCursor& upstream) {
+        upstreams_.push_back(&upstream);
+    }
+
+    bool empty() const {
+        return upstreams_.empty();
+    }
+
+    /**
+     * @brief 可以处理的序号上限
+     * @param ceiling 没有上游时返回的上限
+     * @return 序号小于返回值的消息已被所有上游处理完
+     */
+    uint64_t available(uint64_t ceiling = UINT64_MAX) const {
+        for (const SequenceCursor* upstream : upstreams_) {
+            const uint64_t sequence = upstream->load();
+            if (sequence < ceiling) {
+                ceiling = sequence;
+            }
+        }
+        return ceiling;
+    }
+
+private:
+    std::vector<const SequenceCursor*> upstreams_;   // 上游阶段的进度
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+/**
+ * @brief 连续内存视图
+ *
+ * C++20 下直接使用 std::span；C++17 下提供一个只含常用接口的替代实现，
+ * 使批量接口在两种标准下的写法完全相同。
+ */
+#if __cplusplus >= 202002L
+template<typename T>
+using Span = std::span<T>;
+#else
+template<typename T>
+class Span {
+public:
+    constexpr Span() noexcept = default;
+    constexpr Span(T* data, size_t size) noexcept : data_(data), size_(size) {}
+
+    template<size_t N>
+    constexpr Span(T (&array)[N]) noexcept : data_(array), size_(N) {}
+
+    // 允许 Span<T> 隐式转换为 Span<const T>
+    template<typename U, typename = decltype(static_cast<T*>(static_cast<U*>(nullptr)))>
+    constexpr Span(const Span<U>& other) noexcept : data_(other.data()), size_(other.size()) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr T& operator[](size_t index) const noexcept { return data_[index]; }
+    constexpr T& front() const noexcept { return data_[0]; }
+    constexpr T& back() const noexcept { return data_[size_ - 1]; }
+
+    constexpr Span first(size_t count) const noexcept { return Span(data_, count); }
+    constexpr Span subspan(size_t offset) const noexcept { return Span(data_ + offset, size_ - offset); }
+    constexpr Span subspan(size_t offset, size_t count) const noexcept { return Span(data_ + offset, count); }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+#endif
@@ -0,0 +1,154 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @brief 溢出文件头，位于文件开头，独占第一页
+ *
+ * 文件格式(小端，定长记录):
+ * - [0, 页大小): 文件头
+ * - [页大小, 页大小 + capacity * record_size): 记录环形区，每条记录是 T 的原始字节
+ */
+struct SpillFileHeader {
+    static constexpr char MAGIC[8] = {'N', 'B', 'Q', 'S', 'P', 'I', 'L', 'L'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];          // 魔数
+    uint32_t version;       // 格式版本
+    uint32_t record_size;   // 单条记录字节数，即 sizeof(T)
+    uint64_t capacity;      // 可容纳的记录数
+    uint64_t head;          // 最早记录的下标
+    uint64_t count;         // 当前记录数
+};
+
+/**
+ * @brief 内存映射的溢出文件，以先进先出方式暂存队列放不下的消息
+ * @tparam T 消息类型，必须可平凡复制，按原始字节写入文件
+ *
+ * 文件用 ftruncate 一次性扩展到最大容量(稀疏文件，只有写过的部分占用磁盘)，
+ * 通过 MAP_SHARED 映射后直接读写，写回由内核页缓存负责，不调用 msync。
+ * 溢出文件只用于削峰，不保证崩溃后可恢复: 构造时清空已有内容，析构时删除文件。
+ * 不是线程安全的，由单个生产者线程独占使用。
+ */
+template<typename T>
+class SpillFile {
+public:
+    /**
+     * @brief 创建溢出文件
+     * @param path 文件路径，已存在时会被清空
+     * @param capacity 最多可暂存的消息数
+     * @throw std::system_error 创建、扩展或映射文件失败
+     */
+    SpillFile(std::string path, size_t capacity)
+        : path_(std::move(path)) {
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        data_offset_ = (sizeof(SpillFileHeader) + page - 1) / page * page;
+        mapped_size_ = data_offset_ + (capacity > 0 ? capacity : 1) * sizeof(T);
+
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path_);
+        }
+        if (::ftruncate(fd_, static_cast<off_t>(mapped_size_)) != 0) {
+            const int error = errno;
+            close_file();
+            throw std::system_error(error, std::generic_category(), "ftruncate " + path_);
+        }
+        void* mem = ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mem == MAP_FAILED) {
+            const int error = errno;
+            close_file();
+            throw std::system_error(error, std::generic_category(), "mmap " + path_);
+        }
+        base_ = static_cast<char*>(mem);
+
+        header_ = reinterpret_cast<SpillFileHeader*>(base_);
+        std::memcpy(header_->magic, SpillFileHeader::MAGIC, sizeof(header_->magic));
+        header_->version = SpillFileHeader::VERSION;
+        header_->record_size = static_cast<uint32_t>(sizeof(T));
+        header_->capacity = capacity > 0 ? capacity : 1;
+        header_->head = 0;
+        header_->count = 0;
+    }
+
+    /**
+     * @brief 析构函数，解除映射并删除文件
+     */
+    ~SpillFile() {
+        if (base_ != nullptr) {
+            ::munmap(base_, mapped_size_);
+        }
+        close_file();
+    }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    /**
+     * @brief 在末尾追加一条消息
+     * @return 文件已满返回false
+     */
+    bool push(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "溢出文件按原始字节保存消息，T 必须可平凡复制");
+        if (full()) {
+            return false;
+        }
+        const uint64_t tail = (header_->head + header_->count) % header_->capacity;
+        std::memcpy(record(tail), &value, sizeof(T));
+        header_->count++;
+        return true;
+    }
+
+    /**
+     * @brief 读取最早的一条消息(不移除)，调用前需确认非空
+     */
+    T front() const {
+        T value;
+        std::memcpy(&value, record(header_->head), sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief 移除最早的一条消息，调用前需确认非空
+     *
+     * 清空后回到文件开头，让下一次溢出重新使用已经在页缓存中的页。
+     */
+    void pop_front() {
+        header_->count--;
+        header_->head = header_->count == 0 ? 0 : (header_->head + 1) % header_->capacity;
+    }
+
+    size_t size() const { return header_->count; }
+    size_t capacity() const { return header_->capacity; }
+    bool empty() const { return header_->count == 0; }
+    bool full() const { return header_->count == header_->capacity; }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;                   // 文件路径
+    int fd_ = -1;                        // 文件描述符
+    char* base_ = nullptr;               // 映射起始地址
+    size_t mapped_size_ = 0;             // 映射长度
+    size_t data_offset_ = 0;             // 记录区在文件中的偏移
+    SpillFileHeader* header_ = nullptr;  // 映射中的文件头
+
+    char* record(uint64_t index) const {
+        return base_ + data_offset_ + index * sizeof(T);
+    }
+
+    void close_file() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            ::unlink(path_.c_str());
+            fd_ = -1;
+        }
+    }
+};
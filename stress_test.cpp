@@ -0,0 +1,440 @@
+#include "queue.hpp"
+#include "lock_free_queue_reader.hpp"
+#include "lock_free_queue_consumer.hpp"
+#include "memory_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "timer.hpp"
+
+/**
+ * @brief 节点回收压力测试参数
+ *
+ * 队列很小、消息是堆上分配的 std::string，消费者取走消息、生产者挤出最旧或覆盖最新的消息，
+ * 读取器因此频繁落后、漏读，读取的节点随时可能被取走、挤出或替换。
+ * 配合 -DSANITIZER=address 或 -DSANITIZER=thread 构建时，任何释放后访问都会被报告。
+ */
+constexpr size_t STRESS_QUEUE_CAPACITY = 64;      // 队列容量
+constexpr uint64_t STRESS_MESSAGES = 50000;       // 每个阶段写入的消息数
+constexpr size_t MESSAGE_LENGTH = 64;             // 消息长度，超过短字符串优化，保证节点内容在堆上
+constexpr uint64_t YIELD_INTERVAL = 32;           // 生产者每写入多少条让出一次CPU，让各线程充分交错
+constexpr int TIMEOUT_SEC = 120;                  // 等待读取器追上的最长时间
+constexpr size_t POOL_THREADS = 2;                // 内存池阶段的生产者数和消费者数
+constexpr size_t POOL_PAYLOAD_WORDS = 6;          // 内存池消息的校验字数
+
+using StressQueue = NBQueue<std::string, STRESS_QUEUE_CAPACITY>;
+
+/**
+ * @brief 把序号编码成固定长度的消息: 序号的十进制表示，其余用序号末位对应的字母填充
+ */
+static std::string make_message(uint64_t sequence) {
+    std::string message = std::to_string(sequence);
+    message.resize(MESSAGE_LENGTH, static_cast<char>('a' + sequence % 26));
+    return message;
+}
+
+/**
+ * @brief 解析并校验消息
+ * @return 消息完整时返回其序号，内容损坏返回 UINT64_MAX
+ */
+static uint64_t parse_message(const std::string& message) {
+    if (message.size() != MESSAGE_LENGTH) {
+        return UINT64_MAX;
+    }
+    const uint64_t sequence = std::strtoull(message.c_str(), nullptr, 10);
+    const char fill = static_cast<char>('a' + sequence % 26);
+    if (message.back() != fill) {
+        return UINT64_MAX;
+    }
+    return sequence;
+}
+
+/**
+ * @brief 校验结果: 读到的消息与漏读区间应恰好不重不漏地覆盖所有序号
+ */
+struct Coverage {
+    uint64_t next = 0;          // 下一个期望的序号
+    uint64_t delivered = 0;     // 读到的消息数
+    uint64_t skipped = 0;       // 漏读报告的消息数
+    uint64_t errors = 0;        // 乱序、重复或内容损坏的次数
+
+    void deliver(const std::string& message) {
+        const uint64_t sequence = parse_message(message);
+        if (sequence != next) {
+            errors++;
+        }
+        next = sequence + 1;
+        delivered++;
+    }
+
+    void gap(uint64_t from, uint64_t to) {
+        if (from != next || to <= from) {
+            errors++;
+        }
+        skipped += to - from;
+        next = to;
+    }
+
+    bool ok(uint64_t total) const {
+        return errors == 0 && next == total && delivered + skipped == total;
+    }
+};
+
+/**
+ * @brief 逐条读取的读取器，走 read_sequence
+ */
+class StressReader : public LockFreeQueueReader<StressReader, std::string, STRESS_QUEUE_CAPACITY> {
+    using Base = LockFreeQueueReader<StressReader, std::string, STRESS_QUEUE_CAPACITY>;
+    friend Base;
+
+    void on_data(const std::string& message) {
+        coverage.deliver(message);
+    }
+
+    void on_gap(uint64_t from, uint64_t to) {
+        coverage.gap(from, to);
+    }
+
+public:
+    Coverage coverage;
+
+    explicit StressReader(StressQueue& queue) : Base(queue) {}
+};
+
+/**
+ * @brief 批量读取的读取器，走 read_batch
+ */
+class StressBatchReader : public LockFreeQueueReader<StressBatchReader, std::string, STRESS_QUEUE_CAPACITY> {
+    using Base = LockFreeQueueReader<StressBatchReader, std::string, STRESS_QUEUE_CAPACITY>;
+    friend Base;
+
+    void on_batch(Span<const std::string> messages) {
+        for (const auto& message : messages) {
+            coverage.deliver(message);
+        }
+    }
+
+    void on_gap(uint64_t from, uint64_t to) {
+        coverage.gap(from, to);
+    }
+
+public:
+    Coverage coverage;
+
+    explicit StressBatchReader(StressQueue& queue) : Base(queue) {
+        set_batch_size(16);
+    }
+};
+
+/**
+ * @brief 取走消息的消费者，校验取到的消息严格递增且内容完整
+ */
+class StressConsumer : public LockFreeQueueConsumer<StressConsumer, std::string, STRESS_QUEUE_CAPACITY> {
+    using Base = LockFreeQueueConsumer<StressConsumer, std::string, STRESS_QUEUE_CAPACITY>;
+    friend Base;
+
+    void on_data(std::string&& message) {
+        const uint64_t sequence = parse_message(message);
+        if (sequence == UINT64_MAX || (consumed > 0 && sequence <= last)) {
+            errors++;
+        }
+        last = sequence;
+        consumed++;
+    }
+
+public:
+    uint64_t last = 0;
+    uint64_t consumed = 0;
+    uint64_t errors = 0;
+
+    explicit StressConsumer(StressQueue& queue) : Base(queue) {}
+};
+
+/**
+ * @brief 等待条件成立，超时返回false
+ */
+template<typename Predicate>
+static bool wait_until(Predicate&& predicate) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(TIMEOUT_SEC);
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ * @brief 阶段一: 生产者 + 不停取走消息的消费者 + 紧盯队头的观察者
+ *
+ * 观察者读取的正是消费者下一个要取走并释放的节点，是释放后访问最容易出现的位置。
+ */
+static bool run_pop_phase() {
+    StressQueue queue;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> corrupted{0};     // 观察者和消费者都会计入
+    uint64_t reads = 0;
+
+    std::thread producer([&]() {
+        for (uint64_t i = 0; i < STRESS_MESSAGES; ++i) {
+            std::string message = make_message(i);
+            while (!queue.try_push(message)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread observer([&]() {
+        std::string batch[4];
+        while (!done.load(std::memory_order_relaxed)) {
+            const uint64_t head = queue.head_sequence();
+            if (auto message = queue.read_sequence(head)) {
+                reads++;
+                if (parse_message(*message) != head) {
+                    corrupted++;
+                }
+            }
+            const size_t count = queue.read_batch(head, Span<std::string>(batch, 4));
+            for (size_t i = 0; i < count; ++i) {
+                reads++;
+                if (parse_message(batch[i]) != head + i) {
+                    corrupted++;
+                }
+            }
+        }
+    });
+
+    uint64_t consumed = 0;
+    while (consumed < STRESS_MESSAGES) {
+        if (auto message = queue.pop()) {
+            if (parse_message(*message) != consumed) {
+                corrupted++;
+            }
+            consumed++;
+        }
+    }
+    done = true;
+    producer.join();
+    observer.join();
+
+    const bool ok = corrupted == 0;
+    std::cout << "取走阶段: 消费 " << consumed << ", 观察者读取 " << reads
+              << ", 内容损坏 " << corrupted.load() << (ok ? " 通过" : " 失败") << "\n";
+    return ok;
+}
+
+/**
+ * @brief 阶段二: 挤出最旧消息的生产者 + 消费者 + 两个读取器，校验漏读报告不重不漏
+ */
+static bool run_evict_phase() {
+    StressQueue queue;
+    StressReader reader(queue);
+    StressBatchReader batch_reader(queue);
+    StressConsumer consumer(queue);
+    reader.start();
+    batch_reader.start();
+    consumer.start();
+
+    size_t evicted = 0;
+    for (uint64_t i = 0; i < STRESS_MESSAGES; ++i) {
+        evicted += queue.push_evict_oldest(make_message(i));
+        if (i % YIELD_INTERVAL == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    // 消费者取空队列后，读取器最终都会读到或跳过全部消息
+    const bool drained = wait_until([&]() {
+        return queue.head_sequence() == STRESS_MESSAGES &&
+               reader.cursor().load() == STRESS_MESSAGES &&
+               batch_reader.cursor().load() == STRESS_MESSAGES;
+    });
+    consumer.stop();
+    reader.stop();
+    batch_reader.stop();
+
+    const bool ok = drained &&
+                    reader.coverage.ok(STRESS_MESSAGES) &&
+                    batch_reader.coverage.ok(STRESS_MESSAGES) &&
+                    consumer.errors == 0 &&
+                    consumer.consumed + evicted == STRESS_MESSAGES;
+    std::cout << "挤出阶段: 丢弃 " << evicted << ", 消费 " << consumer.consumed
+              << ", 读取器 读到/漏读 " << reader.coverage.delivered << "/" << reader.coverage.skipped
+              << ", 批量读取器 读到/漏读 " << batch_reader.coverage.delivered << "/" << batch_reader.coverage.skipped
+              << (ok ? " 通过" : " 失败") << "\n";
+    return ok;
+}
+
+/**
+ * @brief 阶段三: 覆盖最新消息的生产者 + 消费者 + 扫描整个队列的观察者，校验读到的消息内容完整
+ */
+static bool run_overwrite_phase() {
+    StressQueue queue;
+    std::atomic<bool> done{false};
+    uint64_t reads = 0;
+    std::atomic<uint64_t> corrupted{0};     // 观察者和消费者都会计入
+
+    std::thread observer([&]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            const uint64_t tail = queue.tail_sequence();
+            for (uint64_t sequence = queue.head_sequence(); sequence < tail; ++sequence) {
+                if (auto message = queue.read_sequence(sequence)) {
+                    reads++;
+                    if (parse_message(*message) == UINT64_MAX) {
+                        corrupted++;
+                    }
+                }
+            }
+            std::this_thread::yield();
+        }
+    });
+    std::thread consumer([&]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            if (auto message = queue.pop()) {
+                if (parse_message(*message) == UINT64_MAX) {
+                    corrupted++;
+                }
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    size_t overwritten = 0;
+    for (uint64_t i = 0; i < STRESS_MESSAGES; ++i) {
+        overwritten += queue.push_overwrite_latest(make_message(i)) ? 1 : 0;
+        if (i % YIELD_INTERVAL == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    observer.join();
+    consumer.join();
+
+    const bool ok = corrupted == 0;
+    std::cout << "覆盖阶段: 覆盖 " << overwritten << ", 观察者读取 " << reads
+              << ", 内容损坏 " << corrupted.load() << (ok ? " 通过" : " 失败") << "\n";
+    return ok;
+}
+
+/**
+ * @brief 节点从 ConcurrentMemoryPool 分配的消息: 生产者线程分配节点，消费者线程释放节点
+ *
+ * 同一块内存若被同时分给两个线程，或释放后仍被写入，校验字会对不上。
+ */
+struct PooledMessage {
+    uint64_t sequence = 0;
+    uint64_t payload[POOL_PAYLOAD_WORDS] = {};
+
+    PooledMessage() = default;
+
+    explicit PooledMessage(uint64_t seq) : sequence(seq) {
+        for (size_t i = 0; i < POOL_PAYLOAD_WORDS; ++i) {
+            payload[i] = seq * (i + 1);
+        }
+    }
+
+    bool intact() const {
+        for (size_t i = 0; i < POOL_PAYLOAD_WORDS; ++i) {
+            if (payload[i] != sequence * (i + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static ConcurrentMemoryPool<PooledMessage>& pool() {
+        static ConcurrentMemoryPool<PooledMessage> instance(1024, -1, false);
+        return instance;
+    }
+
+    static void* operator new(size_t) { return pool().allocate_storage(); }
+    static void operator delete(void* ptr) { pool().deallocate_storage(ptr); }
+};
+
+using PooledQueue = NBQueue<PooledMessage, STRESS_QUEUE_CAPACITY>;
+
+/**
+ * @brief 阶段四: 多个生产者 + 多个消费者，队列节点经 ConcurrentMemoryPool 跨线程分配和释放
+ *
+ * 消费者释放的节点经弹匣和全局仓库流回生产者；消费者同时在本线程分配、释放临时对象，
+ * 两个方向的弹匣交换交错进行。生产者退出前调用 flush_thread_cache()，缓存的对象回到仓库继续使用。
+ */
+static bool run_pool_phase() {
+    PooledQueue queue;
+    std::atomic<uint64_t> consumed{0};
+    std::atomic<uint64_t> corrupted{0};
+    std::atomic<size_t> producers_done{0};
+    constexpr uint64_t per_producer = STRESS_MESSAGES / POOL_THREADS;
+    constexpr uint64_t total = per_producer * POOL_THREADS;
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < POOL_THREADS; ++p) {
+        threads.emplace_back([&, p]() {
+            for (uint64_t i = 0; i < per_producer; ++i) {
+                while (!queue.push(PooledMessage(p * per_producer + i))) {
+                    std::this_thread::yield();
+                }
+                if (i % YIELD_INTERVAL == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            PooledMessage::pool().flush_thread_cache();
+            producers_done++;
+        });
+    }
+    for (size_t c = 0; c < POOL_THREADS; ++c) {
+        threads.emplace_back([&]() {
+            ConcurrentMemoryPool<PooledMessage>& pool = PooledMessage::pool();
+            PooledMessage* local[POOL_PAYLOAD_WORDS] = {};
+            uint64_t rounds = 0;
+            while (consumed.load() < total) {
+                if (auto message = queue.pop()) {
+                    if (!message->intact()) {
+                        corrupted++;
+                    }
+                    consumed++;
+                } else {
+                    std::this_thread::yield();
+                }
+                // 本线程分配后释放的临时对象，与跨线程归还的节点共用弹匣
+                const size_t index = rounds++ % POOL_PAYLOAD_WORDS;
+                if (local[index] != nullptr) {
+                    if (!local[index]->intact()) {
+                        corrupted++;
+                    }
+                    pool.deallocate(local[index]);
+                }
+                local[index] = pool.allocate();
+                *local[index] = PooledMessage(rounds);
+            }
+            for (PooledMessage* object : local) {
+                if (object != nullptr) {
+                    pool.deallocate(object);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const bool ok = corrupted == 0 && consumed == total && producers_done == POOL_THREADS;
+    std::cout << "内存池阶段: 消费 " << consumed.load() << "/" << total
+              << ", 内容损坏 " << corrupted.load() << (ok ? " 通过" : " 失败") << "\n";
+    return ok;
+}
+
+int main() {
+    // 初始化高精度计时器
+    HighResolutionTimer::init();
+
+    const bool pop_ok = run_pop_phase();
+    const bool evict_ok = run_evict_phase();
+    const bool overwrite_ok = run_overwrite_phase();
+    const bool pool_ok = run_pool_phase();
+    return pop_ok && evict_ok && overwrite_ok && pool_ok ? 0 : 1;
+}
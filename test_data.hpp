@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/**
+ * @brief 测试用的自定义数据类型
+ */
+struct TestData {
+    uint64_t timestamp;      // 时间戳
+    uint64_t sequence;       // 序列号
+    uint64_t value;         // 数值
+    uint8_t  flags[4];      // 标志位
+
+    // 构造函数
+    TestData(uint64_t seq = 0) 
+        : timestamp(0)
+        , sequence(seq)
+        , value(0)
+    {
+        flags[0] = 0;
+        flags[1] = 0;
+        flags[2] = 0;
+        flags[3] = 0;
+    }
+};
+
+/**
+ * @brief 数据生成器
+ */
+class DataGenerator {
+public:
+    DataGenerator() : sequence_(0) {
+        // 初始化随机数生成器
+        std::random_device rd;
+        rng_.seed(rd());
+    }
+
+    TestData generate() {
+        TestData data(sequence_++);
+        
+        // 生成随机时间戳
+        data.timestamp = std::chrono::system_clock::now()
+            .time_since_epoch()
+            .count();
+        
+        // 生成随机值
+        data.value = value_dist_(rng_);
+        
+        // 生成随机标志位
+        for (int i = 0; i < 4; ++i) {
+            data.flags[i] = flag_dist_(rng_);
+        }
+        
+        return data;
+    }
+
+private:
+    std::atomic<uint64_t> sequence_;
+    std::mt19937_64 rng_;
+    std::uniform_int_distribution<uint64_t> value_dist_;
+    std::uniform_int_distribution<uint16_t> flag_dist_{0, 255};
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @brief 工作线程的启动选项
+ *
+ * 用于生产者/读取器线程启动时的绑核、调度策略和命名。
+ * 所有字段默认都是"不修改"，即与普通 std::thread 行为一致。
+ */
+struct ThreadOptions {
+    std::vector<int> cpus;       // 绑定的CPU集合，为空表示不绑核
+    int fifo_priority = 0;       // 大于0时切换到SCHED_FIFO并使用该优先级
+    std::string name;            // 线程名(用于perf/top)，为空表示不命名，最长15个字符
+};
+
+/**
+ * @brief 应用线程选项的结果
+ *
+ * 每一项记录对应系统调用返回的错误码，0表示成功或未请求该项。
+ */
+struct ThreadSetupResult {
+    int affinity_error = 0;      // pthread_setaffinity_np 错误码
+    int sched_error = 0;         // pthread_setschedparam 错误码
+    int name_error = 0;          // pthread_setname_np 错误码
+
+    bool ok() const {
+        return affinity_error == 0 && sched_error == 0 && name_error == 0;
+    }
+
+    /**
+     * @brief 获取失败项的描述
+     * @return 所有失败项及其错误信息，全部成功时返回空字符串
+     */
+    std::string describe() const {
+        std::stringstream ss;
+        if (affinity_error) {
+            ss << "绑核失败: " << std::strerror(affinity_error) << "\n";
+        }
+        if (sched_error) {
+            ss << "设置SCHED_FIFO失败: " << std::strerror(sched_error) << "\n";
+        }
+        if (name_error) {
+            ss << "设置线程名失败: " << std::strerror(name_error) << "\n";
+        }
+        return ss.str();
+    }
+};
+
+/**
+ * @brief 将线程选项应用到当前线程
+ * @param options 线程选项
+ * @return 各项设置的结果，某一项失败不影响其余项的设置
+ */
+inline ThreadSetupResult apply_thread_options(const ThreadOptions& options) {
+    ThreadSetupResult result;
+    const pthread_t self = pthread_self();
+
+    if (!options.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : options.cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                result.affinity_error = EINVAL;
+                break;
+            }
+            CPU_SET(cpu, &set);
+        }
+        if (result.affinity_error == 0) {
+            result.affinity_error = pthread_setaffinity_np(self, sizeof(set), &set);
+        }
+    }
+
+    if (options.fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = options.fifo_priority;
+        result.sched_error = pthread_setschedparam(self, SCHED_FIFO, &param);
+    }
+
+    if (!options.name.empty()) {
+        result.name_error = pthread_setname_np(self, options.name.c_str());
+    }
+
+    return result;
+}